@@ -0,0 +1,215 @@
+// Host microbenchmarks. Each result is printed as one JSON object per line.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Appliance/AirConditioner/AirConditioner.h"
+#include "Appliance/AirConditioner/Capabilities.h"
+#include "Appliance/AirConditioner/StatusData.h"
+#include "Frame/Frame.h"
+#include "Helpers/AllocTracker.h"
+#include "AcEmulator.h"
+
+using namespace dudanov;
+using namespace dudanov::midea;
+using namespace dudanov::midea::ac;
+
+namespace {
+
+// Minimal measured time of one benchmark (ns)
+const double MIN_TIME = 2e8;
+
+// Keeps results alive so the optimizer can't drop benchmarked code
+volatile uint32_t g_sink;
+
+/// Replays prebuilt byte stream
+class ReplayStream : public Stream {
+ public:
+  explicit ReplayStream(std::vector<uint8_t> data) : m_data(std::move(data)) {}
+  int available() override { return this->m_data.size() - this->m_pos; }
+  int read() override {
+    return this->m_data[this->m_pos++];
+  }
+  int peek() override { return this->m_data[this->m_pos]; }
+  size_t write(uint8_t data) override { return 1; }
+  size_t write(const uint8_t *data, size_t size) override { return size; }
+  void flush() override {}
+  void rewind() { this->m_pos = 0; }
+
+ private:
+  std::vector<uint8_t> m_data;
+  size_t m_pos{};
+};
+
+/// Counts frames passed to request handler
+class RxProbe : public ApplianceBase {
+ public:
+  RxProbe() : ApplianceBase(AIR_CONDITIONER) {}
+  uint32_t frames{};
+
+ protected:
+  void m_onRequest(const Frame &frame) override { ++this->frames; }
+};
+
+/// Runs `op` (returns number of processed frames) until `MIN_TIME` and prints result line
+template<typename Op> void run(const char *name, Op op) {
+  // Warm-up and steady-state allocations
+  uint32_t frames = 0;
+  for (int n = 0; n < 1000; ++n)
+    frames += op();
+#if MIDEA_ALLOC_TRACKING
+  AllocTracker::reset();
+  AllocTracker::setEnabled(true);
+  uint32_t allocFrames = 0;
+  for (int n = 0; n < 1000; ++n)
+    allocFrames += op();
+  AllocTracker::setEnabled(false);
+  const double allocs = allocFrames ? static_cast<double>(AllocTracker::allocations()) / allocFrames : 0;
+  const double bytes = allocFrames ? static_cast<double>(AllocTracker::bytes()) / allocFrames : 0;
+#endif
+  using clock = std::chrono::steady_clock;
+  uint64_t iterations = 0;
+  frames = 0;
+  double elapsed = 0;
+  const auto start = clock::now();
+  do {
+    for (int n = 0; n < 100; ++n)
+      frames += op();
+    iterations += 100;
+    elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  } while (elapsed < MIN_TIME);
+  const double nsPerFrame = frames ? elapsed / frames : 0;
+  printf("{\"bench\":\"%s\",\"iterations\":%llu,\"frames\":%u,\"ns_per_frame\":%.1f,\"frames_per_sec\":%.0f", name,
+         static_cast<unsigned long long>(iterations), frames, nsPerFrame, nsPerFrame ? 1e9 / nsPerFrame : 0);
+#if MIDEA_ALLOC_TRACKING
+  printf(",\"allocs_per_frame\":%.2f,\"bytes_per_frame\":%.1f", allocs, bytes);
+#endif
+  printf("}\n");
+  fflush(stdout);
+}
+
+const uint8_t STATUS[] = {0xC0, 0x01, 0x48, 0x66, 0x7F, 0x7F, 0x00, 0x30, 0x00, 0x10, 0x00, 0x5E,
+                          0x6C, 0x0C, 0x00, 0x55, 0x00, 0x00, 0x00, 0x2D, 0x00, 0x00, 0x00, 0x01};
+
+FrameData statusData() {
+  FrameData data(STATUS, sizeof(STATUS));
+  data.appendCRC();
+  return data;
+}
+
+FrameData capabilitiesData() {
+  FrameData data({0xB5, 0x05, 0x14, 0x02, 0x01, 0x01, 0x15, 0x02, 0x01, 0x00, 0x12, 0x02, 0x01, 0x01,
+                  0x16, 0x02, 0x01, 0x02, 0x25, 0x02, 0x07, 0x22, 0x3C, 0x22, 0x3C, 0x22, 0x3C, 0x01});
+  data.appendCRC();
+  return data;
+}
+
+// Stream of status notifies. Noisy stream has garbage between frames and every fourth frame corrupted.
+std::vector<uint8_t> rxStream(bool noisy) {
+  const Frame frame(AIR_CONDITIONER, 0x03, 0x05, statusData());
+  std::mt19937 random(1);
+  std::vector<uint8_t> stream;
+  for (int n = 0; n < 64; ++n) {
+    const size_t begin = stream.size();
+    stream.insert(stream.end(), frame.data(), frame.data() + frame.size());
+    if (!noisy)
+      continue;
+    if (n % 4 == 3)
+      stream[begin + 12 + random() % 20] ^= 0x10;
+    for (int garbage = random() % 8; garbage; --garbage)
+      stream.push_back(random() % 0xAA);
+  }
+  return stream;
+}
+
+void benchRx(const char *name, bool noisy) {
+  ReplayStream stream(rxStream(noisy));
+  RxProbe probe;
+  probe.setStream(&stream);
+  // One pass over the whole stream per operation
+  run(name, [&]() {
+    const uint32_t before = probe.frames;
+    stream.rewind();
+    while (stream.available())
+      probe.loop();
+    return probe.frames - before;
+  });
+}
+
+void benchControl() {
+  ManualClock clock;
+  AcEmulator emulator(&clock);
+  emulator.config().latency = 0;
+  AirConditioner ac;
+  ac.setClock(&clock);
+  ac.setStream(emulator.stream());
+  // Minimal gap between frames: zero period disables the timer
+  ac.setPeriod(1);
+  ac.setup();
+  const auto step = [&]() {
+    emulator.loop();
+    ac.loop();
+    clock.advance(1);
+  };
+  for (int n = 0; n < 10000; ++n)
+    step();
+  Temp10 target = 170;
+  run("control_tx", [&]() {
+    const uint32_t controls = emulator.stats().controls;
+    Control control;
+    control.targetTemp10 = target = (target < 300) ? target + 5 : 170;
+    ac.control(control);
+    while (emulator.stats().controls == controls)
+      step();
+    return 1U;
+  });
+}
+
+}  // namespace
+
+int main() {
+  const FrameData status = statusData();
+  run("crc8", [&]() {
+    g_sink = FrameData::calcCRC(status.data(), status.size());
+    return 1U;
+  });
+  const Frame frame(AIR_CONDITIONER, 0x03, DEVICE_QUERY, status);
+  run("checksum", [&]() {
+    g_sink = frame.isValid();
+    return 1U;
+  });
+  Frame target(AIR_CONDITIONER, 0x03, DEVICE_QUERY, status);
+  run("frame_set_data", [&]() {
+    target.setData(status);
+    g_sink = target.size();
+    return 1U;
+  });
+  benchRx("rx_clean", false);
+  benchRx("rx_noisy", true);
+  // Full decode: single pass versus separate getters
+  const StatusData decoded(status);
+  run("status_decode", [&]() {
+    const StatusSnapshot snapshot = decoded.snapshot();
+    g_sink = snapshot.targetTemp + snapshot.indoorTemp + snapshot.outdoorTemp + snapshot.humiditySetpoint +
+             snapshot.mode + snapshot.fanMode + snapshot.swingMode + snapshot.preset;
+    return 1U;
+  });
+  run("status_decode_getters", [&]() {
+    g_sink = decoded.getTargetTemp10() + decoded.getIndoorTemp10() + decoded.getOutdoorTemp10() +
+             static_cast<uint32_t>(decoded.getHumiditySetpoint()) + decoded.getMode() + decoded.getFanMode() +
+             decoded.getSwingMode() + decoded.getPreset();
+    return 1U;
+  });
+  run("status_target_temp", [&]() {
+    g_sink = decoded.getTargetTemp10();
+    return 1U;
+  });
+  const FrameData caps = capabilitiesData();
+  run("capabilities_read", [&]() {
+    Capabilities capabilities;
+    g_sink = capabilities.read(caps);
+    return 1U;
+  });
+  benchControl();
+  return 0;
+}
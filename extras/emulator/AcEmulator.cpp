@@ -0,0 +1,296 @@
+#include "AcEmulator.h"
+#include "Frame/Frame.h"
+#include <algorithm>
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+static const uint8_t APPLIANCE = 0xAC;
+// Minimal size of 0xB5 response parsed by `Capabilities::read()`
+static const uint8_t CAPABILITIES_MIN_SIZE = 14;
+// Energy counter step: 0.01 kWh in tenths of W * ms
+static const uint64_t ENERGY_STEP = 10ULL * 3600ULL * 1000ULL * 10ULL;
+
+AcEmulator::AcEmulator(Clock *clock) : m_caps(defaultCapabilities()), m_random(1), m_clock(clock) {
+  this->m_lastUnsolicited = this->m_lastPowerQuery = clock->now();
+}
+
+std::vector<EmulatorCapability> AcEmulator::defaultCapabilities() {
+  return {
+    {0x0214, {0x01}},  // modes: auto, cool, dry, heat
+    {0x0215, {0x00}},  // swing: vertical
+    {0x0212, {0x01}},  // eco
+    {0x0213, {0x01}},  // freeze protection
+    {0x021A, {0x01}},  // turbo
+    {0x0210, {0x00}},  // fan speed control
+    {0x0216, {0x02}},  // power calculation
+    {0x0224, {0x01}},  // light control
+    {0x021F, {0x00}},  // humidity
+    {0x022C, {0x01}},  // buzzer
+    {0x0225, {34, 60, 34, 60, 34, 60, 1}},  // temperature ranges
+  };
+}
+
+void AcEmulator::setCapabilities(std::vector<EmulatorCapability> caps, uint8_t pageSize) {
+  this->m_caps = std::move(caps);
+  this->m_pageSize = pageSize ? pageSize : 1;
+}
+
+int AcEmulator::LinkStream::read() {
+  if (this->m_rx.empty())
+    return -1;
+  const uint8_t data = this->m_rx.front();
+  this->m_rx.pop_front();
+  return data;
+}
+
+size_t AcEmulator::LinkStream::write(const uint8_t *data, size_t size) {
+  if (this->m_emulator->m_config.partialWrites && size) {
+    const size_t accepted = std::uniform_int_distribution<size_t>(0, size)(this->m_emulator->m_random);
+    if (accepted < size)
+      ++this->m_emulator->m_stats.partialWrites;
+    size = accepted;
+  }
+  this->m_tx.insert(this->m_tx.end(), data, data + size);
+  return size;
+}
+
+bool AcEmulator::m_chance(float probability) {
+  return probability > 0 && std::uniform_real_distribution<float>(0, 1)(this->m_random) < probability;
+}
+
+void AcEmulator::loop() {
+  if (this->m_config.seed) {
+    this->m_random.seed(this->m_config.seed);
+    this->m_config.seed = 0;
+  }
+  this->m_parse();
+  const TimerTick now = this->m_clock->now();
+  while (!this->m_pending.empty() && static_cast<long>(now - this->m_pending.front().due) >= 0) {
+    this->m_deliver(this->m_pending.front().data);
+    this->m_pending.pop_front();
+  }
+  if (this->m_config.unsolicitedInterval && now - this->m_lastUnsolicited >= this->m_config.unsolicitedInterval) {
+    this->m_lastUnsolicited = now;
+    this->m_sendUnsolicited();
+  }
+}
+
+TimerTick AcEmulator::untilNextEvent() const {
+  const TimerTick now = this->m_clock->now();
+  TimerTick next = TimerManager::TIMER_NEVER;
+  if (!this->m_pending.empty()) {
+    const long remain = static_cast<long>(this->m_pending.front().due - now);
+    next = (remain > 0) ? remain : 0;
+  }
+  if (this->m_config.unsolicitedInterval) {
+    const TimerTick elapsed = now - this->m_lastUnsolicited;
+    const TimerTick remain = (elapsed < this->m_config.unsolicitedInterval) ? this->m_config.unsolicitedInterval - elapsed : 0;
+    next = std::min(next, remain);
+  }
+  return next;
+}
+
+void AcEmulator::m_parse() {
+  std::vector<uint8_t> &buf = this->m_stream.m_tx;
+  for (;;) {
+    auto start = std::find(buf.begin(), buf.end(), Frame::START_BYTE);
+    buf.erase(buf.begin(), start);
+    if (buf.size() < 2)
+      return;
+    const uint8_t len = buf[Frame::OFFSET_LENGTH];
+    if (len <= Frame::OFFSET_DATA) {
+      ++this->m_stats.invalidFrames;
+      buf.erase(buf.begin());
+      continue;
+    }
+    if (buf.size() < len + 1U)
+      return;
+    uint8_t cs = 0;
+    for (uint8_t n = Frame::OFFSET_LENGTH; n <= len; ++n)
+      cs += buf[n];
+    if (cs) {
+      ++this->m_stats.invalidFrames;
+      buf.erase(buf.begin());
+      continue;
+    }
+    ++this->m_stats.framesReceived;
+    this->m_protocol = buf[Frame::OFFSET_PROTOCOL];
+    const uint8_t type = buf[Frame::OFFSET_TYPE];
+    const FrameData data(buf.data() + Frame::OFFSET_DATA, len - Frame::OFFSET_DATA);
+    buf.erase(buf.begin(), buf.begin() + len + 1);
+    this->m_onFrame(type, data);
+  }
+}
+
+void AcEmulator::m_onFrame(uint8_t type, const FrameData &data) {
+  if (data.size() < 2 || !data.hasValidCRC()) {
+    ++this->m_stats.invalidFrames;
+    return;
+  }
+  const uint8_t *p = data.data();
+  const uint8_t id = (data.size() >= 3) ? p[data.size() - 2] : 0;
+  switch (p[0]) {
+    case 0x40:
+      this->m_control(data);
+      this->m_reply(type, this->m_status(id));
+      break;
+    case 0x41:
+      if (p[1] == 0x21 && data.size() > 3 && p[3] == 0x44)
+        this->m_reply(type, this->m_power(id));
+      else
+        this->m_reply(type, this->m_status(id));
+      break;
+    case 0xB5:
+      // Continuation requests are the same for all pages
+      this->m_capsPage = (data.size() > 3 && p[2] == 0x01) ? this->m_capsPage + 1 : 0;
+      this->m_reply(type, this->m_capabilities(this->m_capsPage));
+      break;
+    case 0xB0:
+    case 0xB1: {
+      // Properties: every requested ID is reported as successful zero byte
+      std::vector<uint8_t> tlv{p[0], 0};
+      for (const uint8_t *it = p + 2; it + 2 < p + data.size() && tlv[1] < p[1];) {
+        tlv.insert(tlv.end(), {it[0], it[1], 0x00, 0x01, 0x00});
+        ++tlv[1];
+        it += (p[0] == 0xB0) ? 3 + it[2] : 2;
+      }
+      FrameData frame(tlv.data(), tlv.size());
+      frame.appendCRC();
+      this->m_reply(type, std::move(frame));
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void AcEmulator::m_reply(uint8_t type, FrameData data) {
+  const Frame frame(APPLIANCE, this->m_protocol, type, data);
+  this->m_pending.push_back({this->m_clock->now() + this->m_config.latency,
+                             std::vector<uint8_t>(frame.data(), frame.data() + frame.size())});
+  ++this->m_stats.framesSent;
+}
+
+void AcEmulator::m_deliver(const std::vector<uint8_t> &data) {
+  for (uint8_t byte : data) {
+    if (this->m_chance(this->m_config.byteLoss)) {
+      ++this->m_stats.bytesLost;
+      continue;
+    }
+    if (this->m_chance(this->m_config.corruption)) {
+      byte ^= 1 << std::uniform_int_distribution<int>(0, 7)(this->m_random);
+      ++this->m_stats.bytesCorrupted;
+    }
+    this->m_stream.m_rx.push_back(byte);
+  }
+}
+
+void AcEmulator::m_sendUnsolicited() {
+  // Alternate network status queries and status notifies
+  this->m_unsolicitedStatus = !this->m_unsolicitedStatus;
+  if (this->m_unsolicitedStatus) {
+    this->m_reply(0x05, this->m_status(0));
+    return;
+  }
+  FrameData query(static_cast<uint8_t>(20));
+  this->m_reply(0x63, std::move(query));
+}
+
+static void putTemp(uint8_t &integer, uint8_t &decimal, Temp10 temp) {
+  integer = static_cast<uint8_t>(temp / 10 * 2 + 50);
+  decimal = static_cast<uint8_t>((temp < 0) ? -(temp % 10) : temp % 10);
+}
+
+FrameData AcEmulator::m_status(uint8_t id) const {
+  const EmulatorState &s = this->m_state;
+  uint8_t p[24]{0xC0};
+  p[1] = s.power ? 0x01 : 0x00;
+  const uint8_t target = s.targetTemp / 10;
+  p[2] = (s.mode << 5) | ((s.targetTemp % 10) ? 0x10 : 0x00) | ((target - 16) & 15);
+  p[3] = s.fanMode;
+  p[7] = 0x30 | s.swingMode;
+  p[8] = (s.preset == Preset::PRESET_TURBO) ? 0x20 : 0x00;
+  p[9] = (s.preset == Preset::PRESET_ECO) ? 0x10 : 0x00;
+  p[10] = (s.preset == Preset::PRESET_SLEEP) ? 0x01 : 0x00;
+  uint8_t indoorDecimal, outdoorDecimal;
+  putTemp(p[11], indoorDecimal, s.indoorTemp);
+  putTemp(p[12], outdoorDecimal, s.outdoorTemp);
+  p[13] = (target - 12) & 31;
+  p[15] = (outdoorDecimal << 4) | indoorDecimal;
+  p[19] = s.humidity & 127;
+  p[21] = (s.preset == Preset::PRESET_FREEZE_PROTECTION) ? 0x80 : 0x00;
+  p[23] = id;
+  FrameData data(p, sizeof(p));
+  data.appendCRC();
+  return data;
+}
+
+static void putBCD(uint8_t *p, uint32_t value, uint8_t num) {
+  for (p += num - 1; num; --num, --p, value /= 100)
+    *p = ((value % 100 / 10) << 4) | (value % 10);
+}
+
+FrameData AcEmulator::m_power(uint8_t id) {
+  const TimerTick now = this->m_clock->now();
+  this->m_energyRest += static_cast<uint64_t>(this->m_state.power10) * (now - this->m_lastPowerQuery);
+  this->m_lastPowerQuery = now;
+  this->m_state.energy = (this->m_state.energy + this->m_energyRest / ENERGY_STEP) % 100000000;
+  this->m_energyRest %= ENERGY_STEP;
+  uint8_t p[24]{0xC1, 0x21, 0x01, 0x44};
+  putBCD(p + 4, this->m_state.energy, 4);
+  putBCD(p + 16, this->m_state.power10, 3);
+  p[23] = id;
+  FrameData data(p, sizeof(p));
+  data.appendCRC();
+  return data;
+}
+
+FrameData AcEmulator::m_capabilities(uint8_t page) const {
+  const size_t begin = std::min<size_t>(page * this->m_pageSize, this->m_caps.size());
+  const size_t end = std::min<size_t>(begin + this->m_pageSize, this->m_caps.size());
+  std::vector<uint8_t> payload{0xB5, static_cast<uint8_t>(end - begin)};
+  for (size_t n = begin; n < end; ++n) {
+    const EmulatorCapability &cap = this->m_caps[n];
+    payload.insert(payload.end(), {static_cast<uint8_t>(cap.id), static_cast<uint8_t>(cap.id >> 8),
+                                   static_cast<uint8_t>(cap.value.size())});
+    payload.insert(payload.end(), cap.value.begin(), cap.value.end());
+  }
+  if (end < this->m_caps.size())
+    payload.insert(payload.end(), {0x01, 0x00});
+  else
+    payload.resize(std::max<size_t>(payload.size(), CAPABILITIES_MIN_SIZE - 1));
+  FrameData data(payload.data(), payload.size());
+  data.appendCRC();
+  return data;
+}
+
+void AcEmulator::m_control(const FrameData &data) {
+  if (data.size() < 22)
+    return;
+  ++this->m_stats.controls;
+  const uint8_t *p = data.data();
+  EmulatorState &s = this->m_state;
+  s.power = p[1] & 0x01;
+  if (s.power)
+    s.mode = static_cast<Mode>(p[2] >> 5);
+  const uint8_t target = (p[18] & 31) ? (p[18] & 31) + 12 : (p[2] & 15) + 16;
+  s.targetTemp = target * 10 + ((p[2] & 0x10) ? 5 : 0);
+  s.fanMode = static_cast<FanMode>(p[3]);
+  s.swingMode = static_cast<SwingMode>(p[7] & 15);
+  if (p[9] & 0x80)
+    s.preset = Preset::PRESET_ECO;
+  else if ((p[8] & 0x20) || (p[10] & 0x02))
+    s.preset = Preset::PRESET_TURBO;
+  else if (p[10] & 0x01)
+    s.preset = Preset::PRESET_SLEEP;
+  else if (p[21] & 0x80)
+    s.preset = Preset::PRESET_FREEZE_PROTECTION;
+  else
+    s.preset = Preset::PRESET_NONE;
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
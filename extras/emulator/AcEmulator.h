@@ -0,0 +1,134 @@
+#pragma once
+#include <deque>
+#include <random>
+#include <vector>
+#include "Helpers/Platform.h"
+#include "Helpers/Timer.h"
+#include "Frame/FrameData.h"
+#include "Appliance/AirConditioner/StatusData.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// Emulator fault injection and timing settings
+struct EmulatorConfig {
+  /// Delay before response is delivered (ms)
+  uint32_t latency{20};
+  /// Probability of losing each delivered byte
+  float byteLoss{};
+  /// Probability of corrupting each delivered byte
+  float corruption{};
+  /// Period of unsolicited frames (ms): QUERY_NETWORK requests and status notifies. 0 to disable.
+  uint32_t unsolicitedInterval{};
+  /// `write()` of library side accepts random number of bytes
+  bool partialWrites{};
+  /// Seed of fault generator
+  uint32_t seed{1};
+};
+
+/// 0xB5 capability reported by emulator
+struct EmulatorCapability {
+  uint16_t id;
+  std::vector<uint8_t> value;
+};
+
+/// Emulated air conditioner state
+struct EmulatorState {
+  bool power{};
+  Mode mode{Mode::MODE_COOL};
+  Preset preset{Preset::PRESET_NONE};
+  FanMode fanMode{FanMode::FAN_AUTO};
+  SwingMode swingMode{SwingMode::SWING_OFF};
+  Temp10 targetTemp{240};
+  Temp10 indoorTemp{265};
+  Temp10 outdoorTemp{310};
+  uint8_t humidity{45};
+  /// Instant power (tenths of W)
+  uint32_t power10{12345};
+  /// Energy counter (hundredths of kWh). Grows with reported power.
+  uint32_t energy{123456};
+};
+
+/// Emulator counters
+struct EmulatorStats {
+  uint32_t framesReceived;
+  uint32_t framesSent;
+  uint32_t controls;
+  uint32_t bytesLost;
+  uint32_t bytesCorrupted;
+  uint32_t partialWrites;
+  /// Frames from library with wrong length, checksum or CRC. Link to emulator is lossless, so must be zero.
+  uint32_t invalidFrames;
+};
+
+/// In-process Midea air conditioner. Library talks to it through `stream()`.
+class AcEmulator {
+ public:
+  explicit AcEmulator(Clock *clock = &SystemClock::instance());
+  /// Library side of serial link
+  Stream *stream() { return &this->m_stream; }
+  EmulatorConfig &config() { return this->m_config; }
+  EmulatorState &state() { return this->m_state; }
+  const EmulatorStats &stats() const { return this->m_stats; }
+  /// Set reported capabilities. `pageSize` is number of capabilities per 0xB5 response.
+  void setCapabilities(std::vector<EmulatorCapability> caps, uint8_t pageSize = 8);
+  static std::vector<EmulatorCapability> defaultCapabilities();
+  /// Process frames written by library and deliver due responses
+  void loop();
+  /// Time until next scheduled emulator event, or `TimerManager::TIMER_NEVER`
+  TimerTick untilNextEvent() const;
+
+ private:
+  class LinkStream : public Stream {
+   public:
+    explicit LinkStream(AcEmulator *emulator) : m_emulator(emulator) {}
+    int available() override { return this->m_rx.size(); }
+    int read() override;
+    int peek() override { return this->m_rx.empty() ? -1 : this->m_rx.front(); }
+    size_t write(uint8_t data) override { return this->write(&data, 1); }
+    size_t write(const uint8_t *data, size_t size) override;
+    void flush() override {}
+    // Bytes to library
+    std::deque<uint8_t> m_rx;
+    // Bytes from library
+    std::vector<uint8_t> m_tx;
+   private:
+    AcEmulator *m_emulator;
+  };
+  struct Pending {
+    TimerTick due;
+    std::vector<uint8_t> data;
+  };
+  void m_parse();
+  void m_onFrame(uint8_t type, const FrameData &data);
+  void m_reply(uint8_t type, FrameData data);
+  void m_deliver(const std::vector<uint8_t> &data);
+  void m_sendUnsolicited();
+  FrameData m_status(uint8_t id) const;
+  FrameData m_power(uint8_t id);
+  FrameData m_capabilities(uint8_t page) const;
+  void m_control(const FrameData &data);
+  bool m_chance(float probability);
+
+  LinkStream m_stream{this};
+  std::deque<Pending> m_pending;
+  std::vector<EmulatorCapability> m_caps;
+  EmulatorConfig m_config{};
+  EmulatorState m_state{};
+  EmulatorStats m_stats{};
+  std::mt19937 m_random;
+  Clock *m_clock;
+  TimerTick m_lastUnsolicited{};
+  TimerTick m_lastPowerQuery{};
+  // Energy not yet counted in `EmulatorState::energy` (tenths of W * ms)
+  uint64_t m_energyRest{};
+  uint8_t m_pageSize{8};
+  uint8_t m_capsPage{};
+  uint8_t m_protocol{};
+  bool m_unsolicitedStatus{};
+};
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,82 @@
+// Runs poll/control cycles of AirConditioner against emulator and checks steady-state heap allocations of
+// library per cycle. Exits with non-zero status if maximum per cycle differs from budget: exceeding it is a
+// regression, falling below it means budget must be lowered to the new maximum.
+// Usage: midea_alloc_budget [allocations per cycle]
+#include <cstdio>
+#include <cstdlib>
+#include "Appliance/AirConditioner/AirConditioner.h"
+#include "Helpers/AllocTracker.h"
+#include "AcEmulator.h"
+
+using namespace dudanov;
+using namespace dudanov::midea;
+using namespace dudanov::midea::ac;
+
+// Default budget of library allocations per cycle. Set by CMake.
+#ifndef MIDEA_ALLOC_BUDGET
+#define MIDEA_ALLOC_BUDGET 27
+#endif
+
+// Cycles before measurement: startup, autoconf and container growth
+static const uint32_t WARMUP_CYCLES = 100;
+static const uint32_t CYCLES = 5000;
+// Simulated time of cycle (ms): control and at least one status poll
+static const uint32_t CYCLE_TIME = 200;
+
+int main(int argc, char **argv) {
+#if MIDEA_ALLOC_TRACKING
+  const uint32_t budget = (argc > 1) ? strtoul(argv[1], nullptr, 10) : MIDEA_ALLOC_BUDGET;
+  ManualClock clock;
+  AcEmulator emulator(&clock);
+  emulator.config().latency = 5;
+  emulator.setCapabilities(AcEmulator::defaultCapabilities(), 4);
+  AirConditioner ac;
+  ac.setClock(&clock);
+  ac.setStream(emulator.stream());
+  ac.setPeriod(50);
+  ac.setAutoconf(true);
+  ac.setup();
+  uint32_t maxAllocs = 0;
+  uint32_t total = 0;
+  uint32_t overruns = 0;
+  for (uint32_t cycle = 0; cycle < WARMUP_CYCLES + CYCLES; ++cycle) {
+    const bool measure = cycle >= WARMUP_CYCLES;
+    // Only library side is accounted
+    AllocTracker::reset();
+    Control control;
+    control.targetTemp10 = 170 + cycle % 2 * 10;
+    control.mode = (cycle % 10 < 5) ? Mode::MODE_COOL : Mode::MODE_HEAT;
+    AllocTracker::setEnabled(measure);
+    ac.control(control);
+    AllocTracker::setEnabled(false);
+    for (uint32_t ms = 0; ms < CYCLE_TIME; ++ms) {
+      emulator.loop();
+      AllocTracker::setEnabled(measure);
+      ac.loop();
+      AllocTracker::setEnabled(false);
+      clock.advance(1);
+    }
+    if (!measure)
+      continue;
+    const uint32_t allocs = AllocTracker::allocations();
+    total += allocs;
+    if (allocs > maxAllocs)
+      maxAllocs = allocs;
+    if (allocs > budget)
+      ++overruns;
+  }
+  if (overruns)
+    fprintf(stderr, "FAIL: %u cycles exceeded budget of %u allocations (max %u)\n", overruns, budget, maxAllocs);
+  else if (maxAllocs < budget)
+    fprintf(stderr, "FAIL: max %u allocations per cycle is below budget %u, lower MIDEA_ALLOC_BUDGET to %u\n",
+            maxAllocs, budget, maxAllocs);
+  const bool ok = maxAllocs == budget && emulator.stats().controls >= CYCLES;
+  printf("{\"test\":\"alloc_budget\",\"cycles\":%u,\"controls\":%u,\"budget\":%u,\"max_allocs\":%u,\"avg_allocs\":%.2f,"
+         "\"overruns\":%u}\n",
+         CYCLES, emulator.stats().controls, budget, maxAllocs, static_cast<double>(total) / CYCLES, overruns);
+  return ok ? 0 : 1;
+#else
+  printf("{\"test\":\"alloc_budget\",\"skipped\":\"MIDEA_ALLOC_TRACKING is off\"}\n");
+  return 0;
+#endif
+}
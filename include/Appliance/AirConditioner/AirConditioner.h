@@ -3,7 +3,11 @@
 #include "Appliance/ApplianceBase.h"
 #include "Appliance/AirConditioner/Capabilities.h"
 #include "Appliance/AirConditioner/StatusData.h"
+#include "Appliance/AirConditioner/EnergyMeter.h"
+#include "Appliance/AirConditioner/Properties.h"
 #include "Helpers/Helpers.h"
+#include "Helpers/Seqlock.h"
+#include "Helpers/SensorFilter.h"
 
 namespace dudanov {
 namespace midea {
@@ -11,6 +15,9 @@ namespace ac {
 
 // Air conditioner control command
 struct Control {
+  /// Target temperature in tenths of degree. Takes precedence over `targetTemp`.
+  Optional<Temp10> targetTemp10{};
+  /// Compatibility shim: target temperature in degrees
   Optional<float> targetTemp{};
   Optional<Mode> mode{};
   Optional<Preset> preset{};
@@ -18,47 +25,131 @@ struct Control {
   Optional<SwingMode> swingMode{};
 };
 
+// Air conditioner state
+struct State {
+  Temp10 targetTemp{};
+  Temp10 indoorTemp{};
+  Temp10 outdoorTemp{};
+  uint8_t indoorHumidity{};
+  float powerUsage{};
+  // Accumulated energy (Wh)
+  uint32_t energy{};
+  Mode mode{Mode::MODE_OFF};
+  Preset preset{Preset::PRESET_NONE};
+  FanMode fanMode{FanMode::FAN_AUTO};
+  SwingMode swingMode{SwingMode::SWING_OFF};
+  // State is restored from storage and not confirmed by appliance yet
+  bool stale{};
+};
+
 class AirConditioner : public ApplianceBase {
  public:
   AirConditioner() : ApplianceBase(AIR_CONDITIONER) {}
   void m_setup() override;
-  void m_onIdle() override { this->m_getStatus(); }
+  bool m_queueStatus() override {
+    this->m_getStatus();
+    return true;
+  }
+  bool m_queueAutoconf() override;
   void control(const Control &control);
   void setPowerState(bool state);
-  bool getPowerState() const { return this->m_mode != Mode::MODE_OFF; }
-  void togglePowerState() { this->setPowerState(this->m_mode == Mode::MODE_OFF); }
-  float getTargetTemp() const { return this->m_targetTemp; }
-  float getIndoorTemp() const { return this->m_indoorTemp; }
-  float getOutdoorTemp() const { return this->m_outdoorTemp; }
-  float getIndoorHum() const { return this->m_indoorHumidity; }
-  float getPowerUsage() const { return this->m_powerUsage; }
-  Mode getMode() const { return this->m_mode; }
-  SwingMode getSwingMode() const { return this->m_swingMode; }
-  FanMode getFanMode() const { return this->m_fanMode; }
-  Preset getPreset() const { return this->m_preset; }
+  bool getPowerState() const { return this->m_state.mode != Mode::MODE_OFF; }
+  void togglePowerState() { this->setPowerState(this->m_state.mode == Mode::MODE_OFF); }
+  Temp10 getTargetTemp10() const { return this->m_state.targetTemp; }
+  Temp10 getIndoorTemp10() const { return this->m_state.indoorTemp; }
+  Temp10 getOutdoorTemp10() const { return this->m_state.outdoorTemp; }
+  float getTargetTemp() const { return temp10ToFloat(this->m_state.targetTemp); }
+  float getIndoorTemp() const { return temp10ToFloat(this->m_state.indoorTemp); }
+  float getOutdoorTemp() const { return temp10ToFloat(this->m_state.outdoorTemp); }
+  float getIndoorHum() const { return static_cast<float>(this->m_state.indoorHumidity); }
+  float getPowerUsage() const { return this->m_state.powerUsage; }
+  /// Accumulated energy (Wh)
+  uint32_t getEnergy() const { return this->m_state.energy; }
+  /// Restore accumulated energy (Wh), e.g. from application storage
+  void setEnergy(uint32_t energy) { this->m_energyMeter.setEnergy(energy); }
+  /// Set 0xC1 power polling interval (ms), 0 to disable. Must be set before `setup()`. Polling runs only
+  /// in idle slots and only if capabilities report power calculation support. Due query takes at most one of
+  /// four idle slots, the others stay with status polling.
+  void setPowerPollingInterval(uint32_t interval) { this->m_powerPollingInterval = interval; }
+  Mode getMode() const { return this->m_state.mode; }
+  SwingMode getSwingMode() const { return this->m_state.swingMode; }
+  FanMode getFanMode() const { return this->m_state.fanMode; }
+  Preset getPreset() const { return this->m_state.preset; }
+  /// State is restored from storage on warm start and not confirmed by appliance yet
+  bool isStateStale() const { return this->m_state.stale; }
+  /// Persist last status in storage and restore it at `setup()`. Storage must be set.
+  void setWarmStart(bool state) { this->m_warmStart = state; }
+  /// Consistent copy of the whole state. Lock-free and safe to call from any thread.
+  State snapshot() const { return this->m_snapshot.load(); }
   const Capabilities &getCapabilities() const { return this->m_capabilities; }
+  /// Set report deadband and minimal report interval (ms) of sensor field: FIELD_INDOOR_TEMP,
+  /// FIELD_OUTDOOR_TEMP (deadband in degrees), FIELD_HUMIDITY (in percents) or FIELD_POWER_USAGE (in watts).
+  /// Control fields are always reported instantly.
+  void setSensorFilter(StateField field, float deadband, uint32_t minInterval = 0);
   void displayToggle() { this->m_displayToggle(); }
+  /// Read extended properties in one 0xB1 transaction. `onData` is called with iterator over response.
+  void getProperties(GetPropertiesData data, OnPropertiesCallback onData, Handler onError = nullptr) {
+    this->m_queueProperties(std::move(data), 0xB1, std::move(onData), std::move(onError));
+  }
+  /// Write extended properties in one 0xB0 transaction. `onData` is called with iterator over results.
+  void setProperties(SetPropertiesData data, OnPropertiesCallback onData = nullptr, Handler onError = nullptr) {
+    this->m_queueProperties(std::move(data), 0xB0, std::move(onData), std::move(onError));
+  }
  protected:
   void m_getPowerUsage();
-  void m_getCapabilities();
+  /// Query 0xB5 capabilities. In `verify` mode cached capabilities stay active until new report is complete.
+  void m_getCapabilities(bool verify = false);
+  bool m_loadCapabilities();
+  void m_saveCapabilities();
   void m_getStatus();
   void m_setStatus(StatusData status);
+#if MIDEA_HAS_COROUTINES
+  /// Mode change with preset: command without preset, then command with preset
+  Task m_setStatusWithPreset(StatusData status);
+#endif
   void m_displayToggle();
+  void m_queueProperties(FrameData data, uint8_t id, OnPropertiesCallback onData, Handler onError);
   ResponseStatus m_readStatus(FrameData data);
+  /// Apply new raw status. Sensor values are only put into filters. Returns mask of changed fields.
+  StateMask m_updateStatus(StatusData newStatus);
+  bool m_loadState();
+  void m_saveState();
+  /// Publish current state to concurrent readers and notify listeners of changed fields
+  void m_publishState(StateMask changed) {
+    this->m_snapshot.store(this->m_state);
+    this->sendUpdate(changed);
+  }
+  /// Report sensor values passed through filters. Returns mask of reported fields.
+  StateMask m_reportSensors();
+
   Capabilities m_capabilities{};
-  Timer m_powerUsageTimer;
-  float m_indoorHumidity{};
-  float m_indoorTemp{};
-  float m_outdoorTemp{};
-  float m_targetTemp{};
-  float m_powerUsage{};
-  Mode m_mode{Mode::MODE_OFF};
-  Preset m_preset{Preset::PRESET_NONE};
-  FanMode m_fanMode{FanMode::FAN_AUTO};
-  SwingMode m_swingMode{SwingMode::SWING_OFF};
+  // Capabilities being received in verify mode
+  Capabilities m_newCapabilities{};
+  // Delayed verification of cached capabilities
+  Timer m_capabilitiesTimer;
+  EnergyMeter m_energyMeter{};
+  // Power polling interval
+  uint32_t m_powerPollingInterval{30000};
+  SensorFilter<Temp10> m_indoorTempFilter{};
+  SensorFilter<Temp10> m_outdoorTempFilter{};
+  SensorFilter<uint8_t> m_humidityFilter{};
+  SensorFilter<float> m_powerUsageFilter{};
+  // Current state. Owned by loop thread.
+  State m_state{};
+  // Published state for concurrent readers
+  Seqlock<State> m_snapshot{};
   Preset m_lastPreset{Preset::PRESET_NONE};
+  // Last reported work mode regardless of power state
+  Mode m_rawMode{Mode::MODE_OFF};
   StatusData m_status{};
+  // Prebuilt recurring queries
+  TxFrame m_statusQuery{AIR_CONDITIONER, DEVICE_QUERY, QueryStateData(), QueryStateData::ID_INDEX};
+  TxFrame m_powerQuery{AIR_CONDITIONER, DEVICE_QUERY, QueryPowerData(), QueryPowerData::ID_INDEX};
+  // Last received raw status. Empty until first status is received.
+  StatusData m_rawStatus{FrameData(static_cast<uint8_t>(0))};
   bool m_sendControl{};
+  // Warm start enabled
+  bool m_warmStart{};
 };
 
 }  // namespace ac
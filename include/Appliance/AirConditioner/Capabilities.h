@@ -1,6 +1,6 @@
 #pragma once
 #include "Helpers/Platform.h"
-#include <set>
+#include "Helpers/Helpers.h"
 
 namespace dudanov {
 namespace midea {
@@ -9,106 +9,167 @@ class FrameData;
 
 namespace ac {
 
+/// IDs of 0xB5 capabilities. B0/B1 properties share the same ID space.
+enum CapabilityID : uint16_t {
+  CAPABILITY_INDOOR_HUMIDITY = 0x0015,
+  CAPABILITY_SILKY_COOL = 0x0018,
+  CAPABILITY_SMART_EYE = 0x0030,
+  CAPABILITY_WIND_ON_ME = 0x0032,
+  CAPABILITY_WIND_OF_ME = 0x0033,
+  CAPABILITY_ACTIVE_CLEAN = 0x0039,
+  CAPABILITY_ONE_KEY_NO_WIND_ON_ME = 0x0042,
+  CAPABILITY_BREEZE_CONTROL = 0x0043,
+  CAPABILITY_FAN_SPEED_CONTROL = 0x0210,
+  CAPABILITY_PRESET_ECO = 0x0212,
+  CAPABILITY_PRESET_FREEZE_PROTECTION = 0x0213,
+  CAPABILITY_MODES = 0x0214,
+  CAPABILITY_SWING_MODES = 0x0215,
+  CAPABILITY_POWER = 0x0216,
+  CAPABILITY_NEST = 0x0217,
+  CAPABILITY_AUX_ELECTRIC_HEATING = 0x0219,
+  CAPABILITY_PRESET_TURBO = 0x021A,
+  CAPABILITY_HUMIDITY = 0x021F,
+  CAPABILITY_UNIT_CHANGEABLE = 0x0222,
+  CAPABILITY_LIGHT_CONTROL = 0x0224,
+  CAPABILITY_TEMPERATURES = 0x0225,
+  CAPABILITY_BUZZER = 0x022C,
+};
+
+/// Capability flags. Bit positions in `Capabilities` bitset.
+/// Serialized blob stores raw bitset: bump `Capabilities::BLOB_VERSION` on reordering.
+enum CapabilityFlag : uint8_t {
+  CAP_UPDOWN_FAN,
+  CAP_LEFTRIGHT_FAN,
+  CAP_AUTO_MODE,
+  CAP_COOL_MODE,
+  CAP_DRY_MODE,
+  CAP_HEAT_MODE,
+  CAP_ECO_MODE,
+  CAP_SPECIAL_ECO,
+  CAP_FROST_PROTECTION_MODE,
+  CAP_TURBO_COOL,
+  CAP_TURBO_HEAT,
+  CAP_AUTO_SET_HUMIDITY,
+  CAP_MANUAL_SET_HUMIDITY,
+  CAP_ACTIVE_CLEAN,
+  CAP_BREEZE_CONTROL,
+  CAP_BUZZER,
+  CAP_DECIMALS,
+  CAP_ELECTRIC_AUX_HEATING,
+  CAP_FAN_SPEED_CONTROL,
+  CAP_INDOOR_HUMIDITY,
+  CAP_LIGHT_CONTROL,
+  CAP_NEST_CHECK,
+  CAP_NEST_NEED_CHANGE,
+  CAP_ONE_KEY_NO_WIND_ON_ME,
+  CAP_POWER_CAL,
+  CAP_POWER_CAL_SETTING,
+  CAP_SILKY_COOL,
+  CAP_SMART_EYE,
+  CAP_UNIT_CHANGEABLE,
+  CAP_WIND_OF_ME,
+  CAP_WIND_ON_ME,
+  CAP_NUM,
+};
+
 class Capabilities {
  public:
   // Read from frames
   bool read(const FrameData &data);
   // Dump capabilities
   void dump() const;
+  // Size of serialized blob
+  static const uint8_t BLOB_SIZE = 12;
+  // Serialize to compact versioned blob of `BLOB_SIZE` bytes
+  void serialize(uint8_t *data) const;
+  // Restore from blob. Returns `false` if blob is invalid or has another version.
+  bool deserialize(const uint8_t *data, size_t size);
+  // Test capability flag
+  bool has(CapabilityFlag flag) const { return (this->m_flags >> flag) & 1; }
 
   // Control humidity
-  bool autoSetHumidity() const { return this->m_autoSetHumidity; };
-  bool activeClean() const { return this->m_activeClean; };
-  bool breezeControl() const { return this->m_breezeControl; };
-  bool buzzer() const { return this->m_buzzer; }
-  bool decimals() const { return this->m_decimals; }
-  bool electricAuxHeating() const { return this->m_electricAuxHeating; }
-  bool fanSpeedControl() const { return this->m_fanSpeedControl; }
-  bool indoorHumidity() const { return this->m_indoorHumidity; }
+  bool autoSetHumidity() const { return this->has(CAP_AUTO_SET_HUMIDITY); };
+  bool activeClean() const { return this->has(CAP_ACTIVE_CLEAN); };
+  bool breezeControl() const { return this->has(CAP_BREEZE_CONTROL); };
+  bool buzzer() const { return this->has(CAP_BUZZER); }
+  bool decimals() const { return this->has(CAP_DECIMALS); }
+  bool electricAuxHeating() const { return this->has(CAP_ELECTRIC_AUX_HEATING); }
+  bool fanSpeedControl() const { return this->has(CAP_FAN_SPEED_CONTROL); }
+  bool indoorHumidity() const { return this->has(CAP_INDOOR_HUMIDITY); }
   // Control humidity
-  bool manualSetHumidity() const { return this->m_manualSetHumidity; }
-  bool nestCheck() const { return this->m_nestCheck; }
-  bool nestNeedChange() const { return this->m_nestNeedChange; }
-  bool oneKeyNoWindOnMe() const { return this->m_oneKeyNoWindOnMe; }
-  bool powerCal() const { return this->m_powerCal; }
-  bool powerCalSetting() const { return this->m_powerCalSetting; }
-  bool silkyCool() const { return this->m_silkyCool; }
+  bool manualSetHumidity() const { return this->has(CAP_MANUAL_SET_HUMIDITY); }
+  bool nestCheck() const { return this->has(CAP_NEST_CHECK); }
+  bool nestNeedChange() const { return this->has(CAP_NEST_NEED_CHANGE); }
+  bool oneKeyNoWindOnMe() const { return this->has(CAP_ONE_KEY_NO_WIND_ON_ME); }
+  bool powerCal() const { return this->has(CAP_POWER_CAL); }
+  bool powerCalSetting() const { return this->has(CAP_POWER_CAL_SETTING); }
+  bool silkyCool() const { return this->has(CAP_SILKY_COOL); }
   // Intelligent eye function
-  bool smartEye() const { return this->m_smartEye; }
+  bool smartEye() const { return this->has(CAP_SMART_EYE); }
   // Temperature unit can be changed between Celsius and Fahrenheit
-  bool unitChangeable() const { return this->m_unitChangeable; }
-  bool windOfMe() const { return this->m_windOfMe; }
-  bool windOnMe() const { return this->m_windOnMe; }
+  bool unitChangeable() const { return this->has(CAP_UNIT_CHANGEABLE); }
+  bool windOfMe() const { return this->has(CAP_WIND_OF_ME); }
+  bool windOnMe() const { return this->has(CAP_WIND_ON_ME); }
   
   /* MODES */
 
-  bool supportAutoMode() const { return this->m_autoMode; }
-  bool supportCoolMode() const { return this->m_coolMode; }
-  bool supportHeatMode() const { return this->m_heatMode; }
-  bool supportDryMode() const { return this->m_dryMode; }
+  bool supportAutoMode() const { return this->has(CAP_AUTO_MODE); }
+  bool supportCoolMode() const { return this->has(CAP_COOL_MODE); }
+  bool supportHeatMode() const { return this->has(CAP_HEAT_MODE); }
+  bool supportDryMode() const { return this->has(CAP_DRY_MODE); }
 
   /* PRESETS */
 
-  bool supportFrostProtectionPreset() const { return this->m_frostProtectionMode; }
-  bool supportTurboPreset() const { return this->m_turboCool || this->m_turboHeat; }
-  bool supportEcoPreset() const { return this->m_ecoMode || this->m_specialEco; }
+  bool supportFrostProtectionPreset() const { return this->has(CAP_FROST_PROTECTION_MODE); }
+  bool supportTurboPreset() const { return this->has(CAP_TURBO_COOL) || this->has(CAP_TURBO_HEAT); }
+  bool supportEcoPreset() const { return this->has(CAP_ECO_MODE) || this->has(CAP_SPECIAL_ECO); }
 
   /* SWING MODES */
 
-  bool supportVerticalSwing() const { return this->m_updownFan; }
-  bool supportHorizontalSwing() const { return this->m_leftrightFan; }
-  bool supportBothSwing() const { return this->m_updownFan && this->m_leftrightFan; }
+  bool supportVerticalSwing() const { return this->has(CAP_UPDOWN_FAN); }
+  bool supportHorizontalSwing() const { return this->has(CAP_LEFTRIGHT_FAN); }
+  bool supportBothSwing() const { return this->has(CAP_UPDOWN_FAN) && this->has(CAP_LEFTRIGHT_FAN); }
 
   /* TEMPERATURES */
 
-  float maxTempAuto() const { return this->m_maxTempAuto; }
-  float maxTempCool() const { return this->m_maxTempCool; }
-  float maxTempHeat() const { return this->m_maxTempHeat; }
-  float minTempAuto() const { return this->m_minTempAuto; }
-  float minTempCool() const { return this->m_minTempCool; }
-  float minTempHeat() const { return this->m_minTempHeat; }
+  Temp10 maxTempAuto10() const { return this->m_temp10(TEMP_MAX_AUTO); }
+  Temp10 maxTempCool10() const { return this->m_temp10(TEMP_MAX_COOL); }
+  Temp10 maxTempHeat10() const { return this->m_temp10(TEMP_MAX_HEAT); }
+  Temp10 minTempAuto10() const { return this->m_temp10(TEMP_MIN_AUTO); }
+  Temp10 minTempCool10() const { return this->m_temp10(TEMP_MIN_COOL); }
+  Temp10 minTempHeat10() const { return this->m_temp10(TEMP_MIN_HEAT); }
+  float maxTempAuto() const { return temp10ToFloat(this->maxTempAuto10()); }
+  float maxTempCool() const { return temp10ToFloat(this->maxTempCool10()); }
+  float maxTempHeat() const { return temp10ToFloat(this->maxTempHeat10()); }
+  float minTempAuto() const { return temp10ToFloat(this->minTempAuto10()); }
+  float minTempCool() const { return temp10ToFloat(this->minTempCool10()); }
+  float minTempHeat() const { return temp10ToFloat(this->minTempHeat10()); }
 
   // Ability to turn LED display off
-  bool supportLightControl() const { return this->m_lightControl; }
+  bool supportLightControl() const { return this->has(CAP_LIGHT_CONTROL); }
 
  protected:
-  bool m_updownFan{false};
-  bool m_leftrightFan{false};
-  bool m_autoMode{false};
-  bool m_coolMode{false};
-  bool m_dryMode{false};
-  bool m_ecoMode{false};
-  bool m_specialEco{false};
-  bool m_frostProtectionMode{false};
-  bool m_heatMode{false};
-  bool m_turboCool{false};
-  bool m_turboHeat{false};
-  bool m_autoSetHumidity{false};
-  bool m_activeClean{false};
-  bool m_breezeControl{false};
-  bool m_buzzer{false};
-  bool m_decimals{false};
-  bool m_electricAuxHeating{false};
-  bool m_fanSpeedControl{true};
-  bool m_indoorHumidity{false};
-  bool m_lightControl{false};
-  bool m_manualSetHumidity{false};
-  float m_maxTempAuto{30};
-  float m_maxTempCool{30};
-  float m_maxTempHeat{30};
-  float m_minTempAuto{17};
-  float m_minTempCool{17};
-  float m_minTempHeat{17};
-  bool m_nestCheck{false};
-  bool m_nestNeedChange{false};
-  bool m_oneKeyNoWindOnMe{false};
-  bool m_powerCal{false};
-  bool m_powerCalSetting{false};
-  bool m_silkyCool{false};
-  bool m_smartEye{false};
-  bool m_unitChangeable{false};
-  bool m_windOfMe{false};
-  bool m_windOnMe{false};
+  // Indexes of packed temperature ranges. Order is the same as in 0x0225 capability.
+  enum TempIndex : uint8_t {
+    TEMP_MIN_COOL,
+    TEMP_MAX_COOL,
+    TEMP_MIN_AUTO,
+    TEMP_MAX_AUTO,
+    TEMP_MIN_HEAT,
+    TEMP_MAX_HEAT,
+    TEMP_NUM,
+  };
+  Temp10 m_temp10(TempIndex idx) const { return this->m_temps[idx] * 5; }
+  void m_setFlag(CapabilityFlag flag, bool state) {
+    if (state)
+      this->m_flags |= 1UL << flag;
+    else
+      this->m_flags &= ~(1UL << flag);
+  }
+  // Capability flags bitset
+  uint32_t m_flags{1UL << CAP_FAN_SPEED_CONTROL};
+  // Temperature ranges in half of degree
+  uint8_t m_temps[TEMP_NUM]{34, 60, 34, 60, 34, 60};
 };
 
 }  // namespace ac
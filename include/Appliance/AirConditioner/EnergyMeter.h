@@ -0,0 +1,38 @@
+#pragma once
+#include "Helpers/Platform.h"
+#include "Helpers/Timer.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// Accumulates consumed energy from 0xC1 power reports.
+/// Hardware energy counter deltas are used when available, surviving counter wraps and resets.
+/// Otherwise instant power is integrated over time.
+class EnergyMeter {
+ public:
+  /// Feed energy counter (hundredths of kWh, 0 if not supported) and instant power (tenths of W) measured at `now`.
+  void update(uint32_t counter, uint32_t power10, TimerTick now);
+  /// Accumulated energy (Wh)
+  uint32_t getEnergy() const { return this->m_energy; }
+  /// Restore accumulated energy (Wh)
+  void setEnergy(uint32_t energy) { this->m_energy = energy; }
+
+ private:
+  // Accumulated energy (Wh)
+  uint32_t m_energy{};
+  // Last energy counter value
+  uint32_t m_counter{};
+  // Remainder of integrated power (tenths of W * ms)
+  uint64_t m_remainder{};
+  // Last instant power
+  uint32_t m_power10{};
+  // Time of last update
+  TimerTick m_lastTime{};
+  bool m_hasCounter{};
+  bool m_hasPower{};
+};
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
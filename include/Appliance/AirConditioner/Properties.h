@@ -0,0 +1,74 @@
+#pragma once
+#include "Helpers/Platform.h"
+#include <functional>
+#include "Frame/FrameData.h"
+#include "Appliance/AirConditioner/Capabilities.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// 0xB1 query of extended properties. All IDs are packed in one frame.
+class GetPropertiesData : public FrameData {
+ public:
+  GetPropertiesData() : FrameData({0xB1, 0x00}) { this->appendCRC(); }
+  GetPropertiesData(std::initializer_list<uint16_t> ids) : GetPropertiesData() {
+    for (uint16_t id : ids)
+      this->add(id);
+  }
+  /// Append property ID. Ignored if frame would exceed maximal size.
+  GetPropertiesData &add(uint16_t id);
+  /// Number of properties in frame
+  uint8_t count() const { return this->m_data[1]; }
+};
+
+/// 0xB0 set of extended properties. All values are packed in one frame.
+class SetPropertiesData : public FrameData {
+ public:
+  SetPropertiesData() : FrameData({0xB0, 0x00}) { this->appendCRC(); }
+  /// Append property value. Ignored if frame would exceed maximal size.
+  SetPropertiesData &add(uint16_t id, const uint8_t *data, uint8_t size);
+  SetPropertiesData &add(uint16_t id, uint8_t value) { return this->add(id, &value, 1); }
+  /// Number of properties in frame
+  uint8_t count() const { return this->m_data[1]; }
+};
+
+/// Iterator over properties of 0xB0/0xB1 response: ID(2), result(1), size(1), data(size).
+class PropertyData {
+ public:
+  PropertyData(const FrameData &data) :
+    m_it(data.data() + 2),
+    m_end(data.data() + data.size() - 1),
+    m_num(data.size() > 2 ? data.data()[1] : 0) {}
+  // Get property ID
+  uint16_t id() const { return (this->m_it[1] << 8) | this->m_it[0]; }
+  // Result code. Zero on success.
+  uint8_t result() const { return this->m_it[2]; }
+  bool isOk() const { return !this->result(); }
+  // Read-only indexed access to property data
+  const uint8_t &operator[](uint8_t idx) const { return *(this->m_it + idx + 4); }
+  // Get size of property data
+  uint8_t size() const { return this->m_it[3]; }
+  // Current property is complete
+  bool isValid() const { return this->m_num && this->m_available() >= 4 && this->m_available() >= this->size() + 4U; }
+  // Advance to next property
+  void advance() {
+    this->m_it += this->size() + 4;
+    --this->m_num;
+  }
+ private:
+  size_t m_available() const { return this->m_it < this->m_end ? this->m_end - this->m_it : 0; }
+  // Iterator
+  const uint8_t *m_it;
+  // End of data
+  const uint8_t *const m_end;
+  // Number of properties in answer
+  uint8_t m_num;
+};
+
+/// Called once per 0xB0/0xB1 response with iterator at first property
+using OnPropertiesCallback = std::function<void(PropertyData)>;
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
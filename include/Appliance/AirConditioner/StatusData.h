@@ -1,6 +1,7 @@
 #pragma once
 #include "Helpers/Platform.h"
 #include "Frame/FrameData.h"
+#include "Helpers/Helpers.h"
 
 namespace dudanov {
 namespace midea {
@@ -64,6 +65,36 @@ enum Preset : uint8_t {
   PRESET_FREEZE_PROTECTION,
 };
 
+/// Bits of state fields passed to change listeners
+enum StateField : uint32_t {
+  FIELD_MODE = 1 << 0,
+  FIELD_PRESET = 1 << 1,
+  FIELD_FAN_MODE = 1 << 2,
+  FIELD_SWING_MODE = 1 << 3,
+  FIELD_TARGET_TEMP = 1 << 4,
+  FIELD_INDOOR_TEMP = 1 << 5,
+  FIELD_OUTDOOR_TEMP = 1 << 6,
+  FIELD_HUMIDITY = 1 << 7,
+  FIELD_POWER_USAGE = 1 << 8,
+  /// State restored from storage is not confirmed by appliance yet
+  FIELD_STALE = 1 << 9,
+  FIELD_ENERGY = 1 << 10,
+};
+
+/// Status decoded in a single pass over 0xC0 payload
+struct StatusSnapshot {
+  Temp10 targetTemp;
+  Temp10 indoorTemp;
+  Temp10 outdoorTemp;
+  uint8_t humiditySetpoint;
+  Mode mode;
+  Mode rawMode;
+  FanMode fanMode;
+  SwingMode swingMode;
+  Preset preset;
+  bool fahrenheits;
+};
+
 class StatusData : public FrameData {
  public:
   StatusData() : FrameData({0x40, 0x00, 0x00, 0x00, 0x7F, 0x7F, 0x00, 0x00, 0x00, 0x00,
@@ -74,13 +105,21 @@ class StatusData : public FrameData {
   /// Copy status from another StatusData
   void copyStatus(const StatusData &p) { memcpy(this->m_data.data() + 1, p.data() + 1, 10); }
 
+  /// Mask of `StateField` whose raw bytes differ from previous status
+  uint32_t diff(const StatusData &prev) const;
+
+  /// Decode all status fields at once. Single-field getters read only their own bytes.
+  StatusSnapshot snapshot() const;
+
   /* TARGET TEMPERATURE */
-  float getTargetTemp() const;
-  void setTargetTemp(float temp);
+  Temp10 getTargetTemp10() const;
+  void setTargetTemp10(Temp10 temp);
+  float getTargetTemp() const { return temp10ToFloat(this->getTargetTemp10()); }
+  void setTargetTemp(float temp) { this->setTargetTemp10(floatToTemp10(temp)); }
 
   /* MODE */
   Mode getRawMode() const { return static_cast<Mode>(this->m_getValue(2, 7, 5)); }
-  Mode getMode() const;
+  Mode getMode() const { return this->m_getPower() ? this->getRawMode() : Mode::MODE_OFF; }
   void setMode(Mode mode);
 
   /* FAN SPEED */
@@ -92,13 +131,15 @@ class StatusData : public FrameData {
   void setSwingMode(SwingMode mode) { this->m_setValue(7, 0x30 | mode); }
 
   /* INDOOR TEMPERATURE */
-  float getIndoorTemp() const;
+  Temp10 getIndoorTemp10() const;
+  float getIndoorTemp() const { return temp10ToFloat(this->getIndoorTemp10()); }
 
   /* OUTDOOR TEMPERATURE */
-  float getOutdoorTemp() const;
+  Temp10 getOutdoorTemp10() const;
+  float getOutdoorTemp() const { return temp10ToFloat(this->getOutdoorTemp10()); }
 
   /* HUMIDITY SETPOINT */
-  float getHumiditySetpoint() const;
+  float getHumiditySetpoint() const { return static_cast<float>(this->m_getValue(19, 127)); }
 
   /* PRESET */
   Preset getPreset() const;
@@ -120,28 +161,39 @@ class StatusData : public FrameData {
   bool m_getPower() const { return this->m_getValue(1, 1); }
   void m_setPower(bool state) { this->m_setMask(1, state, 1); }
   /* ECO MODE */
-  bool m_getEco() const { return this->m_getValue(9, 16); }
   void m_setEco(bool state) { this->m_setMask(9, state, 128); }
   /* TURBO MODE */
-  bool m_getTurbo() const { return this->m_getValue(8, 32) || this->m_getValue(10, 2); }
   void m_setTurbo(bool state) {
     this->m_setMask(8, state, 32);
     this->m_setMask(10, state, 2);
   }
   /* FREEZE PROTECTION */
-  bool m_getFreezeProtection() const { return this->m_getValue(21, 128); }
   void m_setFreezeProtection(bool state) { this->m_setMask(21, state, 128); }
   /* SLEEP MODE */
-  bool m_getSleep() const { return this->m_getValue(10, 1); }
   void m_setSleep(bool state) { this->m_setMask(10, state, 1); }
 };
 
 
+/// 0xC1 power report
+class PowerData : public FrameData {
+ public:
+  PowerData(const FrameData &data) : FrameData(data) {}
+  /// Instant power (tenths of W)
+  uint32_t getPower10() const { return this->m_getBCD(16, 3); }
+  /// Total energy counter (hundredths of kWh). Wraps at 10^8.
+  uint32_t getEnergyCounter() const { return this->m_getBCD(4, 4); }
+
+ protected:
+  uint32_t m_getBCD(uint8_t idx, uint8_t num) const;
+};
+
 class QueryStateData : public FrameData {
  public:
   QueryStateData() : FrameData({0x41, 0x81, 0x00, 0xFF, 0x03, 0xFF, 0x00, 0x02, 0x00, 0x00,
                                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                 0x03, FrameData::m_getID()}) { this->appendCRC(); }
+  /// Index of sequence byte
+  static const uint8_t ID_INDEX = 21;
 };
 
 class QueryPowerData : public FrameData {
@@ -149,6 +201,8 @@ class QueryPowerData : public FrameData {
   QueryPowerData() : FrameData({0x41, 0x21, 0x01, 0x44, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                 0x00, 0x04, FrameData::m_getID()}) { this->appendCRC(); }
+  /// Index of sequence byte
+  static const uint8_t ID_INDEX = 22;
 };
 
 class DisplayToggleData : public FrameData {
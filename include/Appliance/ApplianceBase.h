@@ -1,10 +1,31 @@
 #pragma once
 #include <deque>
 #include "Helpers/Platform.h"
+#if MIDEA_HAS_THREADS
+#include <atomic>
+#include <functional>
+#include <thread>
+#endif
 #include "Frame/Frame.h"
 #include "Frame/FrameData.h"
 #include "Helpers/Timer.h"
 #include "Helpers/Logger.h"
+#include "Helpers/Helpers.h"
+#include "Helpers/RingBuffer.h"
+#include "Helpers/Coroutine.h"
+#include "Helpers/Storage.h"
+#include "Helpers/Metrics.h"
+#include "Helpers/Profiler.h"
+#include "Helpers/AllocTracker.h"
+
+#ifndef MIDEA_RX_RING_SIZE
+#define MIDEA_RX_RING_SIZE 512
+#endif
+
+// Default bound of request queue. 0 is unbounded.
+#ifndef MIDEA_QUEUE_LIMIT
+#define MIDEA_QUEUE_LIMIT 0
+#endif
 
 namespace dudanov {
 namespace midea {
@@ -32,6 +53,35 @@ enum ResponseStatus : uint8_t {
   RESPONSE_WRONG,
 };
 
+enum StartupStep : uint8_t {
+  STARTUP_STATUS,
+  STARTUP_AUTOCONF,
+  STARTUP_NETWORK,
+};
+
+/// Request queue overflow policy. Requests of same class are the same command: frame type, payload ID and
+/// sub-command byte, or property IDs of 0xB0/0xB1 requests. Status control requests are never of same class.
+enum QueuePolicy : uint8_t {
+  /// New request is rejected
+  QUEUE_REJECT_NEWEST,
+  /// Oldest queued request of same class is dropped. Otherwise new request is rejected.
+  QUEUE_DROP_OLDEST,
+  /// Queued request of same class is replaced in place. Otherwise new request is rejected.
+  QUEUE_REPLACE,
+};
+
+/// Request queue statistics
+struct QueueStats {
+  // Rejected new requests
+  uint32_t rejected;
+  // Dropped queued requests
+  uint32_t dropped;
+  // Replaced queued requests
+  uint32_t replaced;
+  // Maximum queue length
+  uint16_t highWater;
+};
+
 enum FrameType : uint8_t {
   DEVICE_CONTROL = 0x02,
   DEVICE_QUERY = 0x03,
@@ -40,13 +90,56 @@ enum FrameType : uint8_t {
   QUERY_NETWORK = 0x63,
 };
 
+/// Round-trip latency histogram (ms): buckets up to 8, 16, ..., 1024 ms and above
+using LatencyHistogram = Histogram<8, 8>;
+
+/// Protocol counters. Updated in loop thread, readable from any thread without locks.
+struct ProtocolMetrics {
+  /// Index of `FrameType` in `latency`. Returns `LATENCY_TYPES` for unknown types.
+  static size_t typeIndex(uint8_t type) {
+    static const uint8_t TYPES[] = {DEVICE_CONTROL, DEVICE_QUERY, GET_ELECTRONIC_ID, NETWORK_NOTIFY, QUERY_NETWORK};
+    size_t n = 0;
+    while (n < LATENCY_TYPES && TYPES[n] != type)
+      ++n;
+    return n;
+  }
+  static const size_t LATENCY_TYPES = 5;
+  Counter framesTx;
+  Counter framesRx;
+  // Frames dropped by receiver due to wrong checksum
+  Counter checksumErrors;
+  // Received frames with wrong payload CRC
+  Counter crcErrors;
+  // Requests sent again after timeout
+  Counter retries;
+  // Response timeouts
+  Counter timeouts;
+  // Requests failed after all attempts
+  Counter failures;
+  // Frames rejected by response handler while waiting response
+  Counter wrongResponses;
+  // Transmissions aborted because stream did not accept frame in time
+  Counter txStalls;
+  // Current request queue length
+  Counter queueDepth;
+  // Round-trip latency per frame type in order of `typeIndex()`
+  LatencyHistogram latency[LATENCY_TYPES];
+};
+
 using Handler = std::function<void()>;
 using ResponseHandler = std::function<ResponseStatus(FrameData)>;
 using OnStateCallback = std::function<void()>;
+/// Poll plan query generator. Queues one request and returns `true`, or returns `false` if not applicable now.
+using PollGenerator = std::function<bool()>;
+/// Bitmask of changed state fields. Bits are defined by appliance.
+using StateMask = uint32_t;
+using OnChangeCallback = std::function<void(StateMask)>;
+static const StateMask STATE_ALL = UINT32_MAX;
 
 class ApplianceBase {
  public:
-  ApplianceBase(ApplianceType type) : m_appType(type) {}
+  ApplianceBase(ApplianceType type) : m_appType(type) { this->m_receiver.setMetrics(&this->m_metrics); }
+  virtual ~ApplianceBase();
   /// Setup
   void setup();
   /// Loop
@@ -67,69 +160,307 @@ class ApplianceBase {
   /// Set number of request attempts
   void setNumAttempts(uint8_t numAttempts) { this->m_numAttempts = numAttempts; }
   uint8_t getNumAttempts() const { return this->m_numAttempts; }
+  /// Set request queue bound and overflow policy. Dropped and rejected requests get `onError` call.
+  /// Default bound is `MIDEA_QUEUE_LIMIT`, 0 is unbounded.
+  void setQueueLimit(uint16_t limit, QueuePolicy policy = QUEUE_DROP_OLDEST) {
+    this->m_queueLimit = limit;
+    this->m_queuePolicy = policy;
+  }
+  uint16_t getQueueLimit() const { return this->m_queueLimit; }
+  const QueueStats &getQueueStats() const { return this->m_queueStats; }
+  /// Protocol counters and latency histograms
+  const ProtocolMetrics &getMetrics() const { return this->m_metrics; }
+#if MIDEA_PROFILE
+  /// `loop()` phase profiler
+  LoopProfiler &getProfiler() { return this->m_profiler; }
+#endif
   /// Set beeper feedback
   void setBeeper(bool value);
   /// Add listener for appliance state
-  void addOnStateCallback(OnStateCallback cb) { this->m_stateCallbacks.push_back(cb); }
-  void sendUpdate() {
-    for (auto &cb : this->m_stateCallbacks)
-      cb();
+  void addOnStateCallback(OnStateCallback cb, const char *name = nullptr) {
+    this->addOnChangeCallback([cb](StateMask) { cb(); }, STATE_ALL, name);
+  }
+  /// Add listener for changes of selected state fields. Callback receives mask of all changed fields.
+  /// Optional static `name` identifies slow listener in profiler watchdog.
+  void addOnChangeCallback(OnChangeCallback cb, StateMask fields = STATE_ALL, const char *name = nullptr) {
+    this->m_stateCallbacks.push_back({std::move(cb), fields, name});
+  }
+  void sendUpdate(StateMask changed = STATE_ALL) {
+    for (size_t n = 0; n < this->m_stateCallbacks.size(); ++n) {
+      auto &listener = this->m_stateCallbacks[n];
+      if (listener.fields & changed) {
+        MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_CALLBACK, n, listener.name);
+        listener.callback(changed);
+      }
+    }
   }
   AutoconfStatus getAutoconfStatus() const { return this->m_autoconfStatus; }
   void setAutoconf(bool state) { this->m_autoconfStatus = state ? AUTOCONF_PROGRESS : AUTOCONF_DISABLED; }
   static void setLogger(LoggerFn logger) { dudanov::setLogger(logger); }
+  /// Set clock of appliance timers, e.g. `ManualClock` for simulations. Must be set before `setup()`.
+  void setClock(Clock *clock) { this->m_timerManager.setClock(clock); }
+  /// Time until next timer deadline. Simulations may advance clock by this value before next `loop()`.
+  TimerTick untilNextDeadline() const { return this->m_timerManager.untilNextDeadline(); }
+  /// Set persistent storage for cached appliance data. Must be set before `setup()`.
+  void setStorage(Storage *storage) { this->m_storage = storage; }
+  /// Set order of initial transactions queued at `setup()`. Default: status, autoconf, network notify.
+  /// Omitted status is left to polling. Omitted autoconf is still queued last if enabled. Without
+  /// STARTUP_NETWORK the first network notify is sent by periodic network timer 2 minutes after `setup()`.
+  /// Plan with unknown or repeated steps is rejected. Returns `false` if rejected.
+  bool setStartupPlan(std::initializer_list<StartupStep> plan);
+  /// Set gap between request completion and next request during startup. Must not exceed period.
+  void setStartupGap(uint32_t gap) { this->m_startupGap = gap; }
+  /// Time from `setup()` to first received status (ms)
+  const Optional<uint32_t> &getTimeToFirstStatus() const { return this->m_timeToFirstStatus; }
+  /// Time from `setup()` to autoconf completion (ms)
+  const Optional<uint32_t> &getTimeToAutoconf() const { return this->m_timeToAutoconf; }
+
+#if MIDEA_HAS_THREADS
+  /// Blocks RX thread until stream may have data or `timeout` (ms) expires. Must return within timeout,
+  /// so thread can be stopped.
+  using RxWaiter = std::function<void(uint32_t timeout)>;
+#ifndef ARDUINO
+  /// Waiter using `select()` on file descriptor of stream device (host serial port, ESP-IDF UART VFS)
+  static RxWaiter fdWaiter(int fd);
+#endif
+  /// Start dedicated RX thread draining the stream into lock-free ring. Frames are parsed from the ring in
+  /// `loop()`. Call after `setStream()`. RX thread calls `available()` and `read()` while `loop()` writes,
+  /// so stream must support concurrent reading and writing from two threads (e.g. ESP-IDF UART driver).
+  /// Arduino `HardwareSerial` doesn't guarantee this. Thread blocks in `waiter` if set, otherwise it polls
+  /// stream every `pollInterval` ms.
+  void startRxThread(RxWaiter waiter = nullptr, uint32_t pollInterval = 1);
+  /// Stop RX thread. Parsing falls back to direct stream reading.
+  void stopRxThread();
+  bool isRxThreadRunning() const { return this->m_rxRunning.load(std::memory_order_relaxed); }
+  /// Maximum RX ring fill level
+  size_t getRxHighWater() const { return this->m_rxRing.highWater(); }
+  /// Number of bytes lost due to RX ring overflow
+  uint32_t getRxOverruns() const { return this->m_rxRing.overruns(); }
+#endif
 
  protected:
-  std::vector<OnStateCallback> m_stateCallbacks;
+  struct StateListener {
+    OnChangeCallback callback;
+    StateMask fields;
+    const char *name;
+  };
+  std::vector<StateListener> m_stateCallbacks;
+#if MIDEA_PROFILE
+  LoopProfiler m_profiler{};
+#endif
   // Timer manager
   TimerManager m_timerManager{};
   AutoconfStatus m_autoconfStatus{};
+  // Persistent storage
+  Storage *m_storage{nullptr};
   // Beeper feedback flag
   bool m_beeper{};
 
   void m_queueNotify(FrameType type, FrameData data) { this->m_queueRequest(type, std::move(data), nullptr); }
   void m_queueRequest(FrameType type, FrameData data, ResponseHandler onData, Handler onSuccess = nullptr, Handler onError = nullptr);
   void m_queueRequestPriority(FrameType type, FrameData data, ResponseHandler onData = nullptr, Handler onSuccess = nullptr, Handler onError = nullptr);
+  /// Queue request with prebuilt frame owned by appliance. Frame must outlive request.
+  void m_queueRequest(FrameType type, TxFrame *frame, ResponseHandler onData, Handler onSuccess = nullptr, Handler onError = nullptr);
   void m_sendFrame(FrameType type, const FrameData &data);
+  /// Record startup milestone (STARTUP_STATUS or STARTUP_AUTOCONF) reached
+  void m_onStartupStep(StartupStep step);
   // Setup for appliances
   virtual void m_setup() {}
+  /// Queue status query. Used by startup plan. Returns `true` if queued.
+  virtual bool m_queueStatus() { return false; }
+  /// Queue autoconfiguration requests if needed. Used by startup plan. Returns `true` if queued.
+  virtual bool m_queueAutoconf() { return false; }
   // Loop for appliances
   virtual void m_loop() {}
-  /// Calling then ready for request
-  virtual void m_onIdle() {}
+  /// Add query generator to poll plan served in idle slots. Generators share slots proportionally to `weight`
+  /// by smooth weighted round-robin. Generator with non-zero `interval` (ms) takes part only when its interval
+  /// elapsed since last queued request, so it lowers other cadences smoothly instead of preempting them.
+  /// Generator with zero weight is not served.
+  void m_addPoll(PollGenerator generator, uint8_t weight, uint32_t interval = 0);
+  /// Calling then ready for request. Serves poll plan by default.
+  virtual void m_onIdle() { this->m_servePollPlan(); }
   /// Calling on receiving request
   virtual void m_onRequest(const Frame &frame) {}
+#if MIDEA_HAS_COROUTINES
+  class QueryAwaiter;
+#endif
  private:
   struct Request {
     FrameData request;
+    // Prebuilt frame used instead of `request`
+    TxFrame *cached;
     ResponseHandler onData;
     Handler onSuccess;
     Handler onError;
     FrameType requestType;
+#if MIDEA_HAS_COROUTINES
+    // Awaiter owning this request. Such requests are not deleted by queue.
+    QueryAwaiter *awaiter{nullptr};
+#endif
+    // Enqueue order. Priority requests are queued at front, so queue position is not age.
+    uint32_t seq{};
     ResponseStatus callHandler(const Frame &data);
   };
+
+ protected:
+#if MIDEA_HAS_COROUTINES
+  /// Awaitable request for `Task` coroutines. Request is stored in awaiter, so awaiting does no heap work
+  /// besides payload. Resumes from `loop()` with response data, or empty data on failure.
+  class QueryAwaiter {
+   public:
+    QueryAwaiter(ApplianceBase *app, FrameType type, FrameData data, TxFrame *cached, uint8_t responseID, bool priority);
+    QueryAwaiter(const QueryAwaiter &) = delete;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    FrameData await_resume() noexcept { return std::move(this->m_response); }
+
+   private:
+    friend class ApplianceBase;
+    ApplianceBase *m_app;
+    Request m_request;
+    FrameData m_response{FrameData(static_cast<uint8_t>(0))};
+    std::coroutine_handle<> m_handle{};
+    // Next completed awaiter waiting for resumption
+    QueryAwaiter *m_next{nullptr};
+    uint8_t m_responseID;
+    bool m_priority;
+  };
+  /// Awaitable request: `FrameData response = co_await this->m_query(...)`.
+  /// If `responseID` is non-zero, responses with other ID are treated as wrong.
+  QueryAwaiter m_query(FrameType type, FrameData data, uint8_t responseID = 0, bool priority = false) {
+    return QueryAwaiter(this, type, std::move(data), nullptr, responseID, priority);
+  }
+  /// Awaitable request with prebuilt frame owned by appliance
+  QueryAwaiter m_query(FrameType type, TxFrame *frame, uint8_t responseID = 0) {
+    return QueryAwaiter(this, type, FrameData(static_cast<uint8_t>(0)), frame, responseID, false);
+  }
+#endif
+
+ private:
   class FrameReceiver : public Frame {
   public:
     bool read(Stream *stream);
+    template<typename T> bool read(T &ring) {
+      uint8_t data;
+      while (ring.pop(data))
+        if (this->m_feed(data))
+          return true;
+      return false;
+    }
     void clear() { this->m_data.clear(); }
+    void setMetrics(ProtocolMetrics *metrics) { this->m_metrics = metrics; }
+  private:
+    bool m_feed(uint8_t data);
+    ProtocolMetrics *m_metrics{nullptr};
   };
+  bool m_readFrame();
   void m_sendNetworkNotify(FrameType msg_type = NETWORK_NOTIFY);
+  void m_runStartupPlan();
+  void m_runStartupStep(StartupStep step);
+  void m_servePollPlan();
+  struct PollEntry {
+    PollGenerator generator;
+    uint32_t interval;
+    TimerTick last;
+    // Sum of `uint8_t` weights must not overflow
+    int32_t current;
+    uint8_t weight;
+    // Not eligible in current slot
+    bool skip;
+  };
+  // Poll plan
+  std::vector<PollEntry> m_pollPlan;
+  /// Startup lasts until milestones of queued plan steps are reached
+  bool m_isStartup() const { return this->m_startupPending; }
   void m_handler(const Frame &frame);
   bool m_isWaitForResponse() const { return this->m_request != nullptr; }
   void m_resetAttempts() { this->m_remainAttempts = this->m_numAttempts; }
   void m_destroyRequest();
   void m_resetTimeout();
-  void m_sendRequest(Request *request) { this->m_sendFrame(request->requestType, request->request); }
+  /// Put request into bounded queue according to overflow policy
+  void m_enqueue(Request *request, bool priority);
+  /// Command identity of request for overflow policy. Zero if request has no class.
+  static uint32_t m_requestClass(const Request *request);
+  void m_dropRequest(Request *request);
+  /// Delete finished request. Awaiter-owned requests are scheduled for resumption instead.
+  void m_releaseRequest(Request *request);
+#if MIDEA_HAS_COROUTINES
+  /// Resume coroutines whose requests are finished
+  void m_resumeAwaiters();
+  // Finished awaiters in completion order
+  QueryAwaiter *m_awaitersHead{nullptr};
+  QueryAwaiter *m_awaitersTail{nullptr};
+#endif
+  void m_sendRequest(Request *request, bool retry = false);
+  // Send prebuilt frame outside of request
+  void m_sendFrame(FrameType type, TxFrame &frame);
+  void m_startPeriod();
+  void m_recordLatency(FrameType type, uint32_t ms);
+  /// Start transmission of prebuilt `frame` or of frame encoded from `data`. Non-persistent data is copied
+  /// if frame can't be written at once.
+  void m_startTx(const Frame *frame, const FrameData *data, FrameType type, bool persistent, bool isRequest);
+  /// Write as many pending bytes as stream accepts without blocking. Returns `true` if frame is complete.
+  bool m_writeTx();
+  void m_onTxComplete();
+  /// Drop transmission stalled by stream
+  void m_abortTx();
+  bool m_isTransmitting() const { return this->m_tx.offset < this->m_tx.size; }
+  /// Prebuilt `frame` is queued, awaiting response or transmitting
+  bool m_isFrameUsed(const TxFrame *frame) const;
+  struct TxState {
+    // Prebuilt frame. If `nullptr`, frame is encoded from `data`.
+    const Frame *frame;
+    const FrameData *data;
+    size_t offset;
+    size_t size;
+    FrameType type;
+    uint8_t protocol;
+    // Frame of current request
+    bool isRequest;
+  };
+  // Pending transmission
+  TxState m_tx{};
+  // Copy of one-shot payload not sent at once
+  FrameData m_txData{FrameData(static_cast<uint8_t>(0))};
+  // Stream reports free TX space, so zero means full buffer
+  bool m_txReportsSpace{};
+  // Retry of current request is postponed until started frame is written
+  bool m_retryPending{};
+  // Aborts transmission stalled by stream
+  Timer m_txTimer{};
+  ProtocolMetrics m_metrics{};
   // Frame receiver with dynamic buffer
   FrameReceiver m_receiver{};
+#if MIDEA_HAS_THREADS
+  void m_rxTask();
+  // RX ring filled by RX thread
+  SpscRing<MIDEA_RX_RING_SIZE> m_rxRing{};
+  // RX thread
+  std::thread m_rxThread{};
+  // RX thread running flag
+  std::atomic<bool> m_rxRunning{false};
+  // Blocking wait for RX data. Polling with `m_rxPollInterval` if not set.
+  RxWaiter m_rxWaiter{};
+  uint32_t m_rxPollInterval{1};
+#endif
   // Network status timer
   Timer m_networkTimer{};
+  // Network notify frames and network state current frame was built for. New frame is built in other buffer,
+  // so queued or transmitting frame is never changed.
+  TxFrame m_notifyFrames[2]{};
+  uint8_t m_notifyIdx{};
+  uint64_t m_notifyKey{};
   // Waiting response timer
   Timer m_responseTimer{};
   // Request period timer
   Timer m_periodTimer{};
   // Queue requests
   std::deque<Request *> m_queue;
+  QueueStats m_queueStats{};
+  uint16_t m_queueLimit{MIDEA_QUEUE_LIMIT};
+  QueuePolicy m_queuePolicy{QUEUE_DROP_OLDEST};
+  // Counter of enqueued requests
+  uint32_t m_enqueueSeq{};
   // Current request
   Request *m_request{nullptr};
   // Remaining request attempts
@@ -140,6 +471,15 @@ class ApplianceBase {
   uint8_t m_protocol{};
   // Period flag
   bool m_isBusy{};
+  // Startup plan
+  StartupStep m_startupPlan[3]{STARTUP_STATUS, STARTUP_AUTOCONF, STARTUP_NETWORK};
+  uint8_t m_startupPlanSize{3};
+  // Bits `1 << StartupStep` of milestones not reached yet
+  uint8_t m_startupPending{};
+  // Setup time
+  TimerTick m_setupTime{};
+  Optional<uint32_t> m_timeToFirstStatus{};
+  Optional<uint32_t> m_timeToAutoconf{};
 
   /* ############################## */
   /* ### COMMUNICATION SETTINGS ### */
@@ -149,6 +489,8 @@ class ApplianceBase {
   Stream *m_stream;
   // Minimal period between requests
   uint32_t m_period{1000};
+  // Gap after completed request during startup
+  uint32_t m_startupGap{100};
   // Waiting response timeout
   uint32_t m_timeout{2000};
   // Number of request attempts
@@ -0,0 +1,86 @@
+#pragma once
+#include "Helpers/Platform.h"
+#include "Appliance/ApplianceBase.h"
+#include "Appliance/Dehumidifier/StatusData.h"
+#include "Helpers/Helpers.h"
+
+namespace dudanov {
+namespace midea {
+namespace dh {
+
+/// Bits of state fields passed to change listeners
+enum StateField : uint32_t {
+  FIELD_POWER = 1 << 0,
+  FIELD_MODE = 1 << 1,
+  FIELD_FAN_SPEED = 1 << 2,
+  FIELD_TARGET_HUMIDITY = 1 << 3,
+  FIELD_ION = 1 << 4,
+  FIELD_TANK_LEVEL = 1 << 5,
+  FIELD_INDOOR_HUMIDITY = 1 << 6,
+  FIELD_INDOOR_TEMP = 1 << 7,
+  FIELD_ERROR_CODE = 1 << 8,
+};
+
+// Dehumidifier control command
+struct Control {
+  Optional<bool> power{};
+  Optional<Mode> mode{};
+  Optional<FanSpeed> fanSpeed{};
+  Optional<uint8_t> targetHumidity{};
+  Optional<bool> ion{};
+};
+
+// Dehumidifier state
+struct State {
+  Temp10 indoorTemp{};
+  uint8_t indoorHumidity{};
+  uint8_t targetHumidity{};
+  uint8_t tankLevel{};
+  uint8_t errorCode{};
+  Mode mode{Mode::MODE_SETPOINT};
+  FanSpeed fanSpeed{FanSpeed::FAN_MEDIUM};
+  bool power{};
+  bool ion{};
+};
+
+class Dehumidifier : public ApplianceBase {
+ public:
+  Dehumidifier() : ApplianceBase(DEHUMIDIFIER) {}
+  void m_setup() override;
+  bool m_queueStatus() override {
+    this->m_getStatus();
+    return true;
+  }
+  void control(const Control &control);
+  bool getPowerState() const { return this->m_state.power; }
+  void setPowerState(bool state) {
+    Control control;
+    control.power = state;
+    this->control(control);
+  }
+  Mode getMode() const { return this->m_state.mode; }
+  FanSpeed getFanSpeed() const { return this->m_state.fanSpeed; }
+  uint8_t getTargetHumidity() const { return this->m_state.targetHumidity; }
+  uint8_t getIndoorHumidity() const { return this->m_state.indoorHumidity; }
+  Temp10 getIndoorTemp10() const { return this->m_state.indoorTemp; }
+  float getIndoorTemp() const { return temp10ToFloat(this->m_state.indoorTemp); }
+  bool getIon() const { return this->m_state.ion; }
+  uint8_t getTankLevel() const { return this->m_state.tankLevel; }
+  bool isTankFull() const { return this->m_state.tankLevel >= 100; }
+  uint8_t getErrorCode() const { return this->m_state.errorCode; }
+  const State &getState() const { return this->m_state; }
+ protected:
+  void m_getStatus();
+  void m_setStatus(StatusData status);
+  ResponseStatus m_readStatus(FrameData data);
+  State m_state{};
+  // Last received settings. Base of control frames.
+  StatusData m_status{};
+  // Prebuilt status query
+  TxFrame m_statusQuery{DEHUMIDIFIER, DEVICE_QUERY, QueryStateData(), QueryStateData::ID_INDEX};
+  bool m_sendControl{};
+};
+
+}  // namespace dh
+}  // namespace midea
+}  // namespace dudanov
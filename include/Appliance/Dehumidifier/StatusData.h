@@ -0,0 +1,85 @@
+#pragma once
+#include "Helpers/Platform.h"
+#include "Frame/FrameData.h"
+#include "Frame/FieldMap.h"
+#include "Helpers/Helpers.h"
+
+namespace dudanov {
+namespace midea {
+namespace dh {
+
+/// Enum for all modes a Midea dehumidifier can be in
+enum Mode : uint8_t {
+  /// Keep target humidity
+  MODE_SETPOINT = 1,
+  /// Continuous dehumidification
+  MODE_CONTINUOUS = 2,
+  /// Smart mode
+  MODE_SMART = 3,
+  /// Clothes drying
+  MODE_CLOTHES_DRY = 4,
+};
+
+/// Enum for all fan speeds a Midea dehumidifier can be in
+enum FanSpeed : uint8_t {
+  FAN_LOW = 40,
+  FAN_MEDIUM = 60,
+  FAN_HIGH = 80,
+};
+
+/// Fields of 0xC8 status and 0x48 control payloads. Values are indexes in `StatusMap`.
+enum StatusField : size_t {
+  STATUS_POWER,
+  STATUS_MODE,
+  STATUS_FAN_SPEED,
+  STATUS_TARGET_HUMIDITY,
+  STATUS_ION,
+  STATUS_TANK_LEVEL,
+  STATUS_INDOOR_HUMIDITY,
+  /// Tenths of degree
+  STATUS_INDOOR_TEMP,
+  STATUS_ERROR_CODE,
+};
+
+using StatusMap = FieldMap<
+  Field<1, 0x01>,
+  Field<2, 0x0F>,
+  Field<3, 0x7F>,
+  Field<7, 0x7F>,
+  Field<9, 0x01, 6>,
+  Field<10, 0x7F>,
+  Field<16>,
+  Field<17, 0xFF, 0, 5, -50>,
+  Field<21>
+>;
+
+class StatusData : public FieldData<StatusMap> {
+ public:
+  StatusData() : FieldData({0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                            0x00, 0x00, 0x00, 0x00}) {}
+  StatusData(const FrameData &data) : FieldData(data) {}
+  /// Copy settings bytes from received status
+  void copyStatus(const StatusData &p) {
+    if (p.size() >= SETTINGS_END)
+      memcpy(this->m_data.data() + 1, p.data() + 1, SETTINGS_END - 1);
+  }
+  void setBeeper(bool state) { this->m_setMask(1, state, 64); }
+
+ protected:
+  /// End of settings bytes. Following bytes are read-only status.
+  static const uint8_t SETTINGS_END = 10;
+};
+
+class QueryStateData : public FrameData {
+ public:
+  QueryStateData() : FrameData({0x41, 0x81, 0x00, 0xFF, 0x03, 0xFF, 0x00, 0x02, 0x00, 0x00,
+                                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0x03, FrameData::m_getID()}) { this->appendCRC(); }
+  /// Index of sequence byte
+  static const uint8_t ID_INDEX = 21;
+};
+
+}  // namespace dh
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,63 @@
+#pragma once
+#include "Helpers/Platform.h"
+#include <array>
+#include <tuple>
+#include "Frame/FrameData.h"
+
+namespace dudanov {
+namespace midea {
+
+/// Compile-time description of payload field: `value = (((data[Index] >> Shift) & Mask) + Offset) * Scale`.
+template<uint8_t Index, uint8_t Mask = 0xFF, uint8_t Shift = 0, int16_t Scale = 1, int16_t Offset = 0>
+struct Field {
+  static constexpr uint8_t INDEX = Index;
+  static int16_t get(const uint8_t *data) {
+    return (static_cast<int16_t>((data[Index] >> Shift) & Mask) + Offset) * Scale;
+  }
+  static void set(uint8_t *data, int16_t value) {
+    const uint8_t raw = static_cast<uint8_t>(value / Scale - Offset) & Mask;
+    data[Index] = (data[Index] & ~(Mask << Shift)) | (raw << Shift);
+  }
+};
+
+namespace detail {
+constexpr uint8_t maxOf() { return 0; }
+template<typename... T> constexpr uint8_t maxOf(uint8_t a, T... rest) {
+  return a > maxOf(rest...) ? a : maxOf(rest...);
+}
+}  // namespace detail
+
+/// Set of payload fields. Accessors are resolved at compile time.
+template<typename... Fields> struct FieldMap {
+  static constexpr size_t COUNT = sizeof...(Fields);
+  /// Minimal payload size containing all fields
+  static constexpr uint8_t SIZE = detail::maxOf((Fields::INDEX + 1)...);
+  using Values = std::array<int16_t, COUNT>;
+  template<size_t N> using FieldAt = typename std::tuple_element<N, std::tuple<Fields...>>::type;
+  template<size_t N> static int16_t get(const uint8_t *data) { return FieldAt<N>::get(data); }
+  template<size_t N> static void set(uint8_t *data, int16_t value) { FieldAt<N>::set(data, value); }
+  /// Decode all fields in single pass
+  static Values decode(const uint8_t *data) { return Values{{Fields::get(data)...}}; }
+};
+
+/// Frame payload with codec generated from `FieldMap`. Field numbers are indexes in map.
+template<typename Map> class FieldData : public FrameData {
+ public:
+  FieldData(const FrameData &data) : FrameData(data) {}
+  FieldData(std::initializer_list<uint8_t> list) : FrameData(list) {}
+  template<size_t N> int16_t get() const {
+    return (this->size() > Map::template FieldAt<N>::INDEX) ? Map::template get<N>(this->data()) : 0;
+  }
+  template<size_t N> void set(int16_t value) { Map::template set<N>(this->m_data.data(), value); }
+  /// Decode all fields at once. Short payloads are zero-padded.
+  typename Map::Values decode() const {
+    if (this->size() >= Map::SIZE)
+      return Map::decode(this->data());
+    uint8_t buf[Map::SIZE]{};
+    memcpy(buf, this->data(), this->size());
+    return Map::decode(buf);
+  }
+};
+
+}  // namespace midea
+}  // namespace dudanov
@@ -26,6 +26,15 @@ class Frame {
   uint8_t getProtocol() const { return this->m_data[OFFSET_PROTOCOL]; }
   String toString() const;
 
+  static constexpr uint8_t START_BYTE = 0xAA;
+  static constexpr uint8_t OFFSET_START = 0;
+  static constexpr uint8_t OFFSET_LENGTH = 1;
+  static constexpr uint8_t OFFSET_APPTYPE = 2;
+  static constexpr uint8_t OFFSET_SYNC = 3;
+  static constexpr uint8_t OFFSET_PROTOCOL = 8;
+  static constexpr uint8_t OFFSET_TYPE = 9;
+  static constexpr uint8_t OFFSET_DATA = 10;
+
  protected:
   std::vector<uint8_t> m_data;
   void m_trimData() { this->m_data.erase(this->m_data.begin() + OFFSET_DATA, this->m_data.end()); }
@@ -33,14 +42,42 @@ class Frame {
   uint8_t m_len() const { return this->m_data[OFFSET_LENGTH]; }
   void m_appendCS() { this->m_data.push_back(this->m_calcCS()); }
   uint8_t m_calcCS() const;
-  static const uint8_t START_BYTE = 0xAA;
-  static const uint8_t OFFSET_START = 0;
-  static const uint8_t OFFSET_LENGTH = 1;
-  static const uint8_t OFFSET_APPTYPE = 2;
-  static const uint8_t OFFSET_SYNC = 3;
-  static const uint8_t OFFSET_PROTOCOL = 8;
-  static const uint8_t OFFSET_TYPE = 9;
-  static const uint8_t OFFSET_DATA = 10;
+};
+
+/// Writes frame of header, payload and checksum straight to stream. Payload is not copied.
+class FrameEncoder {
+ public:
+  FrameEncoder(uint8_t appliance, uint8_t protocol, uint8_t type, const FrameData &data);
+  size_t size() const { return Frame::OFFSET_DATA + this->m_data.size() + 1; }
+  /// Write up to `num` frame bytes starting from `offset`. Returns number of bytes accepted by stream.
+  size_t write(Stream *stream, size_t offset = 0, size_t num = SIZE_MAX) const;
+  String toString() const;
+
+ private:
+  uint8_t m_header[Frame::OFFSET_DATA];
+  const FrameData &m_data;
+  uint8_t m_cs;
+};
+
+/// Serialized frame for repeated transmission. Before sending only header fields, sequence byte,
+/// CRC and checksum are patched in place.
+class TxFrame : public Frame {
+ public:
+  TxFrame() = default;
+  /// `seqIndex` is payload index of sequence byte renewed on each `prepare()`, or 0 if none.
+  TxFrame(uint8_t appliance, uint8_t type, const FrameData &data, uint8_t seqIndex = 0)
+  : Frame(appliance, 0, type, data), m_seqIndex(seqIndex) {}
+  bool empty() const { return this->m_data.empty(); }
+  /// Patch protocol, type and sequence byte before sending
+  void prepare(uint8_t protocol, uint8_t type);
+
+ protected:
+  // Set byte keeping checksum valid
+  void m_patch(uint8_t idx, uint8_t value) {
+    this->m_data.back() += this->m_data[idx] - value;
+    this->m_data[idx] = value;
+  }
+  uint8_t m_seqIndex{};
 };
 
 }  // namespace midea
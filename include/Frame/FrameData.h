@@ -26,12 +26,15 @@ class FrameData {
     this->appendCRC();
   }
   bool hasValidCRC() const { return !this->m_calcCRC(); }
+  /// CRC8 of raw bytes continuing from `crc`
+  static uint8_t calcCRC(const uint8_t *data, size_t size, uint8_t crc = 0);
  protected:
+  friend class TxFrame;
   std::vector<uint8_t> m_data;
   static uint8_t m_id;
   static uint8_t m_getID() { return FrameData::m_id++; }
   static uint8_t m_getRandom() { return random(256); }
-  uint8_t m_calcCRC() const;
+  uint8_t m_calcCRC() const { return FrameData::calcCRC(this->m_data.data(), this->m_data.size()); }
   uint8_t m_getValue(uint8_t idx, uint8_t mask = 255, uint8_t shift = 0) const;
   void m_setValue(uint8_t idx, uint8_t value, uint8_t mask = 255, uint8_t shift = 0) {
     this->m_data[idx] &= ~(mask << shift);
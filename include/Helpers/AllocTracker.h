@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// Enables accounting of heap allocations by library call sites. Host builds only: replaces global
+/// `operator new` and `operator delete`.
+#ifndef MIDEA_ALLOC_TRACKING
+#define MIDEA_ALLOC_TRACKING 0
+#endif
+
+#if MIDEA_ALLOC_TRACKING
+namespace dudanov {
+
+/// Allocations attributed to call site
+struct AllocSite {
+  const char *name;
+  uint32_t count;
+  uint64_t bytes;
+};
+
+class AllocTracker {
+ public:
+  static const size_t MAX_SITES = 32;
+  /// Site of allocations made outside of any `Scope`
+  static constexpr const char *UNATTRIBUTED = "unattributed";
+  /// Attributes allocations of current thread to `site` while in scope. Site names are compared by pointer.
+  class Scope {
+   public:
+    explicit Scope(const char *site);
+    ~Scope();
+   private:
+    const char *m_prev;
+  };
+  static void setEnabled(bool state);
+  static bool isEnabled();
+  /// Total number of allocations and frees
+  static uint32_t allocations();
+  static uint32_t frees();
+  static uint64_t bytes();
+  /// Copy site statistics to `sites`. Returns number of sites.
+  static size_t getSites(AllocSite *sites, size_t size);
+  static void reset();
+  static void onAlloc(size_t size);
+  static void onFree();
+};
+
+}  // namespace dudanov
+
+#define MIDEA_ALLOC_SCOPE(site) dudanov::AllocTracker::Scope allocScope_(site)
+#else
+#define MIDEA_ALLOC_SCOPE(site)
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+#include "Helpers/Platform.h"
+
+#if MIDEA_HAS_COROUTINES
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+#ifndef MIDEA_CORO_FRAME_SIZE
+#define MIDEA_CORO_FRAME_SIZE 512
+#endif
+
+#ifndef MIDEA_CORO_FRAMES
+#define MIDEA_CORO_FRAMES 4
+#endif
+
+namespace dudanov {
+
+/// Fixed-block pool for coroutine frames. No heap usage. Shared by all appliances, loop thread only.
+class CoroFramePool {
+ public:
+  static void *allocate(size_t size) noexcept;
+  static void deallocate(void *ptr) noexcept;
+  /// Number of frames in use
+  static uint8_t used() noexcept;
+
+ private:
+  struct alignas(std::max_align_t) Block {
+    unsigned char data[MIDEA_CORO_FRAME_SIZE];
+  };
+  static Block s_blocks[MIDEA_CORO_FRAMES];
+  static uint32_t s_usedMask;
+};
+
+/// Eagerly started fire-and-forget coroutine. Frame is taken from `CoroFramePool`.
+/// Evaluates to `false` if the pool was exhausted and coroutine was not started.
+class Task {
+ public:
+  struct promise_type {
+    Task get_return_object() noexcept { return Task(true); }
+    static Task get_return_object_on_allocation_failure() noexcept { return Task(false); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+    static void *operator new(size_t size) noexcept { return CoroFramePool::allocate(size); }
+    static void operator delete(void *ptr) noexcept { CoroFramePool::deallocate(ptr); }
+  };
+  explicit operator bool() const { return this->m_started; }
+
+ private:
+  explicit Task(bool started) : m_started(started) {}
+  bool m_started;
+};
+
+}  // namespace dudanov
+
+#endif  // MIDEA_HAS_COROUTINES
@@ -4,6 +4,12 @@
 
 namespace dudanov {
 
+/// Temperature in tenths of degree
+using Temp10 = int16_t;
+/// Compatibility conversions of `Temp10` to and from floating point degrees
+inline float temp10ToFloat(Temp10 temp) { return static_cast<float>(temp) * 0.1F; }
+inline Temp10 floatToTemp10(float temp) { return static_cast<Temp10>(temp * 10.0F + ((temp < 0.0F) ? -0.5F : 0.5F)); }
+
 template<typename T>
 class Optional {
  public:
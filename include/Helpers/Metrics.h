@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dudanov {
+
+/// Counter updated by one thread and readable from any thread without locks
+class Counter {
+ public:
+  void inc(uint32_t num = 1) { this->set(this->get() + num); }
+  void set(uint32_t value) { this->m_value.store(value, std::memory_order_relaxed); }
+  uint32_t get() const { return this->m_value.load(std::memory_order_relaxed); }
+  void reset() { this->set(0); }
+
+ private:
+  std::atomic<uint32_t> m_value{0};
+};
+
+/// Histogram with fixed exponential buckets. Bucket `n` counts values up to `BASE << n`, last bucket counts the rest.
+/// Single writer, lock-free readers.
+template<size_t N, uint32_t BASE>
+class Histogram {
+ public:
+  static constexpr size_t SIZE = N + 1;
+  void add(uint32_t value) {
+    size_t n = 0;
+    while (n < N && value > bound(n))
+      ++n;
+    this->m_buckets[n].inc();
+    this->m_sum.inc(value);
+    if (value > this->m_max.get())
+      this->m_max.set(value);
+  }
+  /// Upper bound of bucket. Last bucket is unbounded.
+  static uint32_t bound(size_t n) { return (n < N) ? BASE << n : UINT32_MAX; }
+  uint32_t bucket(size_t n) const { return this->m_buckets[n].get(); }
+  uint32_t count() const {
+    uint32_t total = 0;
+    for (const auto &bucket : this->m_buckets)
+      total += bucket.get();
+    return total;
+  }
+  /// Sum of values. Wraps on overflow.
+  uint32_t sum() const { return this->m_sum.get(); }
+  uint32_t max() const { return this->m_max.get(); }
+  void reset() {
+    for (auto &bucket : this->m_buckets)
+      bucket.reset();
+    this->m_sum.reset();
+    this->m_max.reset();
+  }
+
+ private:
+  Counter m_buckets[SIZE];
+  Counter m_sum;
+  Counter m_max;
+};
+
+}  // namespace dudanov
@@ -10,6 +10,7 @@
 #include <string>
 #include <functional>
 
+#ifdef ESP_PLATFORM
 #include "esp_timer.h"
 #include "esp_random.h"
 
@@ -18,6 +19,11 @@ inline unsigned long millis() {
   return (unsigned long)(esp_timer_get_time() / 1000ULL);
 }
 
+// micros() replacement
+inline unsigned long micros() {
+  return (unsigned long)esp_timer_get_time();
+}
+
 // random() replacement
 inline long random(long max) {
   return esp_random() % max;
@@ -26,6 +32,28 @@ inline long random(long max) {
 inline long random(long min, long max) {
   return min + (esp_random() % (max - min));
 }
+#else
+// Host build (Linux): emulator, benchmarks
+#include <chrono>
+
+inline unsigned long micros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+  return micros() / 1000UL;
+}
+
+inline long random(long max) {
+  return std::rand() % max;
+}
+
+inline long random(long min, long max) {
+  return min + (std::rand() % (max - min));
+}
+#endif  // ESP_PLATFORM
 
 // String replacement - use std::string
 using String = std::string;
@@ -45,6 +73,8 @@ class Stream {
   virtual int peek() = 0;
   virtual size_t write(uint8_t data) = 0;
   virtual size_t write(const uint8_t *data, size_t size) = 0;
+  /// Free space in TX buffer. As in Arduino `Print`, 0 if not supported.
+  virtual int availableForWrite() { return 0; }
   virtual void flush() = 0;
 };
 
@@ -59,3 +89,21 @@ class IPAddress {
 };
 
 #endif  // ARDUINO
+
+// Dedicated threads are available on ESP-IDF and Arduino-ESP32 (pthreads)
+#ifndef MIDEA_HAS_THREADS
+#if !defined(ARDUINO) || defined(ARDUINO_ARCH_ESP32)
+#define MIDEA_HAS_THREADS 1
+#else
+#define MIDEA_HAS_THREADS 0
+#endif
+#endif
+
+// C++20 coroutines support. Opt-in with -DMIDEA_HAS_COROUTINES=1: adds static frame pool and changes
+// preset control path.
+#ifndef MIDEA_HAS_COROUTINES
+#define MIDEA_HAS_COROUTINES 0
+#endif
+#if MIDEA_HAS_COROUTINES && !(defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L)
+#error "MIDEA_HAS_COROUTINES requires C++20 coroutines support"
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+#include "Helpers/Platform.h"
+
+/// Enables `ApplianceBase::loop()` phase profiler. Compiled out completely when disabled.
+#ifndef MIDEA_PROFILE
+#define MIDEA_PROFILE 0
+#endif
+
+#if MIDEA_PROFILE
+#include <algorithm>
+#include <functional>
+
+namespace dudanov {
+
+enum ProfilePhase : uint8_t {
+  /// Timers and their callbacks
+  PHASE_TIMERS,
+  /// Appliance `m_loop()`
+  PHASE_APPLIANCE,
+  /// Frame reading and parsing
+  PHASE_RX,
+  /// Response and request handlers
+  PHASE_HANDLER,
+  /// State listeners called by `sendUpdate()`. Index is listener number.
+  PHASE_CALLBACK,
+  /// Idle slot: poll plan generators
+  PHASE_IDLE,
+  /// Frame transmission
+  PHASE_TX,
+  PHASE_NUM,
+};
+
+/// Duration statistics of one phase. Percentiles are estimated from log2 buckets.
+class PhaseStats {
+ public:
+  void add(uint32_t ticks) {
+    ++this->m_buckets[log2(ticks)];
+    ++this->m_count;
+    this->m_sum += ticks;
+    if (ticks > this->m_max)
+      this->m_max = ticks;
+  }
+  uint32_t count() const { return this->m_count; }
+  uint32_t max() const { return this->m_max; }
+  uint32_t mean() const { return this->m_count ? static_cast<uint32_t>(this->m_sum / this->m_count) : 0; }
+  /// Upper bound of bucket containing 99th percentile
+  uint32_t p99() const {
+    if (!this->m_count)
+      return 0;
+    const uint32_t rank = this->m_count - this->m_count / 100;
+    uint32_t total = 0;
+    for (uint8_t n = 0; n < 32; ++n) {
+      total += this->m_buckets[n];
+      if (total >= rank)
+        return std::min((n < 31) ? (2U << n) - 1 : UINT32_MAX, this->m_max);
+    }
+    return this->m_max;
+  }
+  void reset() { *this = PhaseStats(); }
+
+ private:
+  static uint8_t log2(uint32_t value) {
+    uint8_t n = 0;
+    while (value >>= 1)
+      ++n;
+    return n;
+  }
+  uint32_t m_buckets[32]{};
+  uint64_t m_sum{};
+  uint32_t m_count{};
+  uint32_t m_max{};
+};
+
+/// Loop phase profiler. Ticks are CPU cycles on Arduino ESP targets and microseconds elsewhere.
+class LoopProfiler {
+ public:
+  /// Called then phase exceeds budget: phase, its name, listener index and name (`PHASE_CALLBACK`, name may be
+  /// `nullptr`) and duration.
+  using Watchdog = std::function<void(ProfilePhase, const char *, uint8_t, const char *, uint32_t)>;
+  static uint32_t ticks() {
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+    return ESP.getCycleCount();
+#else
+    return micros();
+#endif
+  }
+  static const char *phaseName(ProfilePhase phase) {
+    static const char *const NAMES[] = {"timers", "appliance loop", "rx", "handler", "state callback", "idle", "tx"};
+    return (phase < PHASE_NUM) ? NAMES[phase] : "unknown";
+  }
+  /// Set phase budget (ticks) and watchdog hook
+  void setWatchdog(uint32_t budget, Watchdog watchdog) {
+    this->m_budget = budget;
+    this->m_watchdog = std::move(watchdog);
+  }
+  void record(ProfilePhase phase, uint8_t index, uint32_t ticks, const char *label = nullptr) {
+    this->m_stats[phase].add(ticks);
+    if (this->m_budget && ticks > this->m_budget && this->m_watchdog != nullptr)
+      this->m_watchdog(phase, phaseName(phase), index, label, ticks);
+  }
+  const PhaseStats &getStats(ProfilePhase phase) const { return this->m_stats[phase]; }
+  void reset() {
+    for (auto &stats : this->m_stats)
+      stats.reset();
+  }
+
+ private:
+  PhaseStats m_stats[PHASE_NUM];
+  Watchdog m_watchdog{};
+  uint32_t m_budget{};
+};
+
+/// Records duration of enclosing scope
+class ProfileScope {
+ public:
+  ProfileScope(LoopProfiler &profiler, ProfilePhase phase, uint8_t index = 0, const char *label = nullptr)
+  : m_profiler(profiler), m_start(LoopProfiler::ticks()), m_label(label), m_phase(phase), m_index(index) {}
+  ~ProfileScope() {
+    this->m_profiler.record(this->m_phase, this->m_index, LoopProfiler::ticks() - this->m_start, this->m_label);
+  }
+
+ private:
+  LoopProfiler &m_profiler;
+  uint32_t m_start;
+  const char *m_label;
+  ProfilePhase m_phase;
+  uint8_t m_index;
+};
+
+}  // namespace dudanov
+
+#define MIDEA_PROFILE_SCOPE(profiler, ...) dudanov::ProfileScope profileScope_(profiler, __VA_ARGS__)
+#else
+#define MIDEA_PROFILE_SCOPE(profiler, ...)
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dudanov {
+
+/// Lock-free single-producer/single-consumer byte ring.
+/// `push()` must be called from one thread only, `pop()` from another one.
+template<size_t N>
+class SpscRing {
+  static_assert(N >= 2 && !(N & (N - 1)), "SpscRing size must be a power of two");
+
+ public:
+  /// Producer side. Returns `false` and counts an overrun if the ring is full.
+  bool push(uint8_t data) {
+    const size_t head = this->m_head.load(std::memory_order_relaxed);
+    const size_t used = head - this->m_tail.load(std::memory_order_acquire);
+    if (used >= N) {
+      this->m_overruns.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    this->m_buf[head & (N - 1)] = data;
+    this->m_head.store(head + 1, std::memory_order_release);
+    if (used + 1 > this->m_highWater.load(std::memory_order_relaxed))
+      this->m_highWater.store(used + 1, std::memory_order_relaxed);
+    return true;
+  }
+  /// Consumer side. Returns `false` if the ring is empty.
+  bool pop(uint8_t &data) {
+    const size_t tail = this->m_tail.load(std::memory_order_relaxed);
+    if (tail == this->m_head.load(std::memory_order_acquire))
+      return false;
+    data = this->m_buf[tail & (N - 1)];
+    this->m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  /// Number of bytes waiting in the ring
+  size_t size() const {
+    return this->m_head.load(std::memory_order_acquire) - this->m_tail.load(std::memory_order_acquire);
+  }
+  static constexpr size_t capacity() { return N; }
+  /// Maximum fill level ever observed
+  size_t highWater() const { return this->m_highWater.load(std::memory_order_relaxed); }
+  /// Number of bytes dropped because the ring was full
+  uint32_t overruns() const { return this->m_overruns.load(std::memory_order_relaxed); }
+
+ private:
+  uint8_t m_buf[N];
+  std::atomic<size_t> m_head{0};
+  std::atomic<size_t> m_tail{0};
+  std::atomic<size_t> m_highWater{0};
+  std::atomic<uint32_t> m_overruns{0};
+};
+
+}  // namespace dudanov
@@ -0,0 +1,46 @@
+#pragma once
+#include "Helpers/Timer.h"
+
+namespace dudanov {
+
+/// Report filter for noisy sensor values.
+/// Deadband is applied around the last reported value, so it also acts as hysteresis: value dithering
+/// between adjacent steps inside the band is never reported. Minimal interval limits report rate.
+/// Suppressed values are kept and reported later once they pass both conditions.
+template<typename T>
+class SensorFilter {
+ public:
+  void setDeadband(T deadband) { this->m_deadband = deadband; }
+  T getDeadband() const { return this->m_deadband; }
+  void setMinInterval(uint32_t ms) { this->m_minInterval = ms; }
+  uint32_t getMinInterval() const { return this->m_minInterval; }
+  /// Put new measured value
+  void put(T value) { this->m_value = value; }
+  /// Update `reported` with last measured value if it must be reported at time `now`. Returns `true` if updated.
+  bool report(T &reported, TimerTick now) {
+    if (this->m_value == reported)
+      return false;
+    if (this->m_hasReport) {
+      if (now - this->m_lastReport < this->m_minInterval)
+        return false;
+      const T delta = (this->m_value > reported) ? (this->m_value - reported) : (reported - this->m_value);
+      if (delta < this->m_deadband)
+        return false;
+    }
+    reported = this->m_value;
+    this->m_lastReport = now;
+    this->m_hasReport = true;
+    return true;
+  }
+  /// Set `reported` to last measured value without starting min interval. For values restored from storage.
+  void restore(T &reported) const { reported = this->m_value; }
+
+ private:
+  T m_value{};
+  T m_deadband{};
+  uint32_t m_minInterval{};
+  TimerTick m_lastReport{};
+  bool m_hasReport{};
+};
+
+}  // namespace dudanov
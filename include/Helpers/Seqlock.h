@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace dudanov {
+
+/// Sequence lock publishing trivially copyable values from one writer to any number of readers.
+/// Writer never blocks. Readers never take locks and only retry while a store is in progress.
+template<typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock value must be trivially copyable");
+
+ public:
+  Seqlock() { this->store(T{}); }
+  /// Publish new value. Single writer only.
+  void store(const T &value) {
+    uint32_t buf[WORDS]{};
+    std::memcpy(buf, &value, sizeof(T));
+    const uint32_t seq = this->m_seq.load(std::memory_order_relaxed);
+    this->m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t n = 0; n < WORDS; ++n)
+      this->m_data[n].store(buf[n], std::memory_order_relaxed);
+    this->m_seq.store(seq + 2, std::memory_order_release);
+  }
+  /// Get consistent copy of the last published value. Safe from any thread.
+  T load() const {
+    uint32_t buf[WORDS];
+    uint32_t seq;
+    do {
+      seq = this->m_seq.load(std::memory_order_acquire);
+      for (size_t n = 0; n < WORDS; ++n)
+        buf[n] = this->m_data[n].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != this->m_seq.load(std::memory_order_relaxed));
+    T value;
+    std::memcpy(&value, buf, sizeof(T));
+    return value;
+  }
+  /// Number of published values
+  uint32_t version() const { return this->m_seq.load(std::memory_order_acquire) / 2; }
+
+ private:
+  static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  std::atomic<uint32_t> m_seq{0};
+  std::atomic<uint32_t> m_data[WORDS];
+};
+
+}  // namespace dudanov
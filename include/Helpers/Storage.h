@@ -0,0 +1,46 @@
+#pragma once
+#include "Helpers/Platform.h"
+
+namespace dudanov {
+
+/// Persistent storage of small binary blobs. Use separate storage (directory, namespace) for each appliance.
+class Storage {
+ public:
+  virtual ~Storage() = default;
+  /// Load blob into `data` buffer of `size` bytes. Returns number of bytes read, 0 if not found.
+  virtual size_t load(const char *key, uint8_t *data, size_t size) = 0;
+  /// Save blob. Returns `true` on success.
+  virtual bool save(const char *key, const uint8_t *data, size_t size) = 0;
+};
+
+/// Checksum of stored blob: two's complement of bytes sum
+uint8_t blobChecksum(const uint8_t *data, size_t size);
+
+#ifndef ARDUINO
+/// Storage keeping each blob in separate file of directory
+class FileStorage : public Storage {
+ public:
+  FileStorage(const char *dir) : m_dir(dir) {}
+  size_t load(const char *key, uint8_t *data, size_t size) override;
+  bool save(const char *key, const uint8_t *data, size_t size) override;
+
+ private:
+  void m_path(char *buf, size_t size, const char *key) const;
+  const char *m_dir;
+};
+#endif
+
+#ifdef ESP_PLATFORM
+/// Storage in ESP32 NVS namespace. NVS flash must be initialized by application.
+class NvsStorage : public Storage {
+ public:
+  NvsStorage(const char *ns) : m_ns(ns) {}
+  size_t load(const char *key, uint8_t *data, size_t size) override;
+  bool save(const char *key, const uint8_t *data, size_t size) override;
+
+ private:
+  const char *m_ns;
+};
+#endif
+
+}  // namespace dudanov
@@ -10,33 +10,75 @@ using TimerTick = unsigned long;
 using TimerCallback = std::function<void(Timer *)>;
 using Timers = std::list<Timer *>;
 
+/// Source of millisecond ticks
+class Clock {
+ public:
+  virtual ~Clock() = default;
+  virtual TimerTick now() = 0;
+};
+
+/// System clock based on `millis()`
+class SystemClock : public Clock {
+ public:
+  TimerTick now() override;
+  static SystemClock &instance();
+};
+
+/// Manually driven clock for simulations and tests
+class ManualClock : public Clock {
+ public:
+  TimerTick now() override { return this->m_now; }
+  void set(TimerTick ms) { this->m_now = ms; }
+  void advance(TimerTick ms) { this->m_now += ms; }
+
+ private:
+  TimerTick m_now{};
+};
+
 class TimerManager {
  public:
-  static TimerTick ms() { return TimerManager::s_millis; }
-  void registerTimer(Timer &timer) { m_timers.push_back(&timer); }
+  /// Time of last update
+  TimerTick ms() const { return this->m_millis; }
+  /// Update time without processing timers
+  void update() { this->m_millis = this->m_clock->now(); }
+  /// Set clock. Default is system clock.
+  void setClock(Clock *clock) { this->m_clock = clock; }
+  Clock *getClock() const { return this->m_clock; }
+  void registerTimer(Timer &timer);
   void task();
+  /// Time until nearest enabled timer expires, or `TIMER_NEVER` if no timers are enabled
+  TimerTick untilNextDeadline() const;
+  static const TimerTick TIMER_NEVER = static_cast<TimerTick>(-1);
 
  private:
-  static TimerTick s_millis;
+  Clock *m_clock{&SystemClock::instance()};
+  TimerTick m_millis{};
   Timers m_timers;
 };
 
 class Timer {
  public:
   Timer();
-  bool isExpired() const { return TimerManager::ms() - this->m_last >= this->m_alarm; }
+  bool isExpired() const { return this->m_now() - this->m_last >= this->m_alarm; }
   bool isEnabled() const { return this->m_alarm; }
   void start(TimerTick ms) {
     this->m_alarm = ms;
     this->reset();
   }
   void stop() { this->m_alarm = 0; }
-  void reset() { this->m_last = TimerManager::ms(); }
+  TimerTick elapsed() const { return this->m_now() - this->m_last; }
+  TimerTick getAlarm() const { return this->m_alarm; }
+  void reset() { this->m_last = this->m_now(); }
   void setCallback(TimerCallback cb) { this->m_callback = cb; }
   void call() { this->m_callback(this); }
  private:
+  friend class TimerManager;
+  // Time of owning manager. Unregistered timers use system clock.
+  TimerTick m_now() const { return (this->m_manager != nullptr) ? this->m_manager->ms() : SystemClock::instance().now(); }
   // Функция обратного вызова или лямбда
   TimerCallback m_callback;
+  // Владелец таймера
+  const TimerManager *m_manager{nullptr};
   // Период срабатывания
   TimerTick m_alarm;
   // Последнее время срабатывания
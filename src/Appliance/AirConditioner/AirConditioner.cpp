@@ -7,16 +7,48 @@ namespace midea {
 namespace ac {
 
 static const char *TAG = "AirConditioner";
+static const char *CAPABILITIES_KEY = "caps";
+// Delay before background verification of cached capabilities
+static const uint32_t CAPABILITIES_VERIFY_DELAY = 60 * 1000;
+static const char *STATE_KEY = "state";
+// Fields changing persisted state. Sensor changes are not persisted to save flash.
+static const StateMask CONTROL_FIELDS = FIELD_MODE | FIELD_PRESET | FIELD_FAN_MODE | FIELD_SWING_MODE | FIELD_TARGET_TEMP;
 
 void AirConditioner::m_setup() {
-  if (this->m_autoconfStatus != AUTOCONF_DISABLED)
-    this->m_getCapabilities();
-  // this->m_timerManager.registerTimer(this->m_powerUsageTimer);
-  // this->m_powerUsageTimer.setCallback([this](Timer *timer) {
-  //   timer->reset();
-  //   this->m_getPowerUsage();
-  // });
-  // this->m_powerUsageTimer.start(30000);
+  if (this->m_warmStart)
+    this->m_loadState();
+  if (this->m_autoconfStatus != AUTOCONF_DISABLED) {
+    if (this->m_loadCapabilities()) {
+      this->m_autoconfStatus = AUTOCONF_OK;
+      this->m_onStartupStep(STARTUP_AUTOCONF);
+      this->m_timerManager.registerTimer(this->m_capabilitiesTimer);
+      this->m_capabilitiesTimer.setCallback([this](Timer *timer) {
+        timer->stop();
+        this->m_getCapabilities(true);
+      });
+      this->m_capabilitiesTimer.start(CAPABILITIES_VERIFY_DELAY);
+    }
+  }
+  // Poll plan. Due power query takes at most one of four idle slots.
+  this->m_addPoll([this]() {
+    this->m_getStatus();
+    return true;
+  }, 3);
+  if (this->m_powerPollingInterval) {
+    this->m_addPoll([this]() {
+      if (!this->m_capabilities.powerCal())
+        return false;
+      this->m_getPowerUsage();
+      return true;
+    }, 1, this->m_powerPollingInterval);
+  }
+}
+
+bool AirConditioner::m_queueAutoconf() {
+  if (this->m_autoconfStatus != AUTOCONF_PROGRESS)
+    return false;
+  this->m_getCapabilities();
+  return true;
 }
 
 static bool checkConstraints(const Mode &mode, const Preset &preset) {
@@ -41,16 +73,18 @@ static bool checkConstraints(const Mode &mode, const Preset &preset) {
 void AirConditioner::control(const Control &control) {
   if (this->m_sendControl)
     return;
-  StatusData status = this->m_status;
-  Mode mode = this->m_mode;
-  Preset preset = this->m_preset;
+  Mode mode = this->m_state.mode;
+  Preset preset = this->m_state.preset;
+  // Changes are collected first, so status is copied only if control frame is sent
+  Optional<FanMode> fanMode{};
+  Optional<SwingMode> swingMode{};
   bool hasUpdate = false;
   bool isModeChanged = false;
   if (control.mode.hasUpdate(mode)) {
     hasUpdate = true;
     isModeChanged = true;
     mode = control.mode.value();
-    if (this->m_mode == Mode::MODE_OFF)
+    if (this->m_state.mode == Mode::MODE_OFF)
       preset = this->m_lastPreset;
     else if (!checkConstraints(mode, preset))
       preset = Preset::PRESET_NONE;
@@ -61,30 +95,37 @@ void AirConditioner::control(const Control &control) {
   }
   if (mode != Mode::MODE_OFF) {
     if (mode == Mode::MODE_AUTO || preset != Preset::PRESET_NONE) {
-      if (this->m_fanMode != FanMode::FAN_AUTO) {
-        hasUpdate = true;
-        status.setFanMode(FanMode::FAN_AUTO);
-      }
-    } else if (control.fanMode.hasUpdate(this->m_fanMode)) {
-      hasUpdate = true;
-      status.setFanMode(control.fanMode.value());
+      if (this->m_state.fanMode != FanMode::FAN_AUTO)
+        fanMode = FanMode::FAN_AUTO;
+    } else if (control.fanMode.hasUpdate(this->m_state.fanMode)) {
+      fanMode = control.fanMode.value();
     }
-    if (control.swingMode.hasUpdate(this->m_swingMode)) {
-      hasUpdate = true;
-      status.setSwingMode(control.swingMode.value());
-    }
-  }
-  if (control.targetTemp.hasUpdate(this->m_targetTemp)) {
-    hasUpdate = true;
-    status.setTargetTemp(control.targetTemp.value());
+    if (control.swingMode.hasUpdate(this->m_state.swingMode))
+      swingMode = control.swingMode.value();
   }
-  if (hasUpdate) {
+  Optional<Temp10> targetTemp = control.targetTemp10;
+  if (!targetTemp.hasValue() && control.targetTemp.hasValue())
+    targetTemp = floatToTemp10(control.targetTemp.value());
+  const bool hasTargetTemp = targetTemp.hasUpdate(this->m_state.targetTemp);
+  if (hasUpdate || fanMode.hasValue() || swingMode.hasValue() || hasTargetTemp) {
+    StatusData status = this->m_status;
+    if (fanMode.hasValue())
+      status.setFanMode(fanMode.value());
+    if (swingMode.hasValue())
+      status.setSwingMode(swingMode.value());
+    if (hasTargetTemp)
+      status.setTargetTemp10(targetTemp.value());
     this->m_sendControl = true;
     status.setMode(mode);
     status.setPreset(preset);
     status.setBeeper(this->m_beeper);
     status.appendCRC();
     if (isModeChanged && preset != Preset::PRESET_NONE && preset != Preset::PRESET_SLEEP) {
+#if MIDEA_HAS_COROUTINES
+      // Falls back to continuations if coroutine frame pool is exhausted
+      if (this->m_setStatusWithPreset(status))
+        return;
+#endif
       // Last command with preset
       this->m_setStatus(status);
       status.setPreset(Preset::PRESET_NONE);
@@ -118,42 +159,69 @@ void AirConditioner::m_setStatus(StatusData status) {
   );
 }
 
+#if MIDEA_HAS_COROUTINES
+Task AirConditioner::m_setStatusWithPreset(StatusData status) {
+  // First command without preset
+  StatusData first = status;
+  first.setPreset(Preset::PRESET_NONE);
+  first.setBeeper(false);
+  first.updateCRC();
+  for (StatusData *data : {&first, &status}) {
+    LOG_D(TAG, "Sending a SET_STATUS(0x40) request...");
+    FrameData response = co_await this->m_query(FrameType::DEVICE_CONTROL, std::move(*data), 0xC0, true);
+    if (!response.size()) {
+      LOG_W(TAG, "SET_STATUS(0x40) request failed...");
+      break;
+    }
+    this->m_readStatus(std::move(response));
+  }
+  this->m_sendControl = false;
+}
+#endif
+
 void AirConditioner::setPowerState(bool state) {
   if (state != this->getPowerState()) {
     Control control;
-    control.mode = state ? this->m_status.getRawMode() : Mode::MODE_OFF;
+    control.mode = state ? this->m_rawMode : Mode::MODE_OFF;
     this->control(control);
   }
 }
 
 void AirConditioner::m_getPowerUsage() {
-  QueryPowerData data{};
   LOG_D(TAG, "Enqueuing a GET_POWERUSAGE(0x41) request...");
-  this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
+  this->m_queueRequest(FrameType::DEVICE_QUERY, &this->m_powerQuery,
     // onData
     [this](FrameData data) -> ResponseStatus {
-      const auto status = data.to<StatusData>();
-      if (!status.hasPowerInfo())
+      if (!data.hasPowerInfo())
         return ResponseStatus::RESPONSE_WRONG;
-      if (this->m_powerUsage != status.getPowerUsage()) {
-        this->m_powerUsage = status.getPowerUsage();
-        this->sendUpdate();
+      const PowerData power = data.to<PowerData>();
+      this->m_powerUsageFilter.put(static_cast<float>(power.getPower10()) * 0.1F);
+      this->m_energyMeter.update(power.getEnergyCounter(), power.getPower10(), this->m_timerManager.ms());
+      StateMask changed = this->m_reportSensors();
+      if (this->m_state.energy != this->m_energyMeter.getEnergy()) {
+        this->m_state.energy = this->m_energyMeter.getEnergy();
+        changed |= FIELD_ENERGY;
       }
+      if (changed)
+        this->m_publishState(changed);
       return ResponseStatus::RESPONSE_OK;
     }
   );
 }
 
-void AirConditioner::m_getCapabilities() {
+void AirConditioner::m_getCapabilities(bool verify) {
   GetCapabilitiesData data{};
-  this->m_autoconfStatus = AUTOCONF_PROGRESS;
+  if (verify)
+    this->m_newCapabilities = Capabilities();
+  else
+    this->m_autoconfStatus = AUTOCONF_PROGRESS;
   LOG_D(TAG, "Enqueuing a priority GET_CAPABILITIES(0xB5) request...");
   this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
     // onData
-    [this](FrameData data) -> ResponseStatus {
+    [this, verify](FrameData data) -> ResponseStatus {
       if (!data.hasID(0xB5))
         return ResponseStatus::RESPONSE_WRONG;
-      if (this->m_capabilities.read(data)) {
+      if ((verify ? this->m_newCapabilities : this->m_capabilities).read(data)) {
         GetCapabilitiesSecondData data{};
         this->m_sendFrame(FrameType::DEVICE_QUERY, data);
         return ResponseStatus::RESPONSE_PARTIAL;
@@ -161,26 +229,85 @@ void AirConditioner::m_getCapabilities() {
       return ResponseStatus::RESPONSE_OK;
     },
     // onSuccess
-    [this]() {
+    [this, verify]() {
+      if (verify) {
+        uint8_t cached[Capabilities::BLOB_SIZE], actual[Capabilities::BLOB_SIZE];
+        this->m_capabilities.serialize(cached);
+        this->m_newCapabilities.serialize(actual);
+        if (!memcmp(cached, actual, sizeof(cached)))
+          return;
+        LOG_I(TAG, "Cached capabilities are outdated. Updating...");
+        this->m_capabilities = this->m_newCapabilities;
+      }
       this->m_autoconfStatus = AUTOCONF_OK;
+      this->m_onStartupStep(STARTUP_AUTOCONF);
+      this->m_saveCapabilities();
     },
     // onError
-    [this]() {
+    [this, verify]() {
       LOG_W(TAG, "Failed to get 0xB5 capabilities report.");
-      this->m_autoconfStatus = AUTOCONF_ERROR;
+      if (!verify) {
+        this->m_autoconfStatus = AUTOCONF_ERROR;
+        this->m_onStartupStep(STARTUP_AUTOCONF);
+      }
     }
   );
 }
 
+bool AirConditioner::m_loadCapabilities() {
+  if (this->m_storage == nullptr)
+    return false;
+  uint8_t blob[Capabilities::BLOB_SIZE];
+  const size_t size = this->m_storage->load(CAPABILITIES_KEY, blob, sizeof(blob));
+  if (!this->m_capabilities.deserialize(blob, size))
+    return false;
+  LOG_D(TAG, "Capabilities restored from storage.");
+  return true;
+}
+
+void AirConditioner::m_saveCapabilities() {
+  if (this->m_storage == nullptr)
+    return;
+  uint8_t blob[Capabilities::BLOB_SIZE];
+  this->m_capabilities.serialize(blob);
+  if (!this->m_storage->save(CAPABILITIES_KEY, blob, sizeof(blob)))
+    LOG_W(TAG, "Failed to save capabilities to storage.");
+}
+
 void AirConditioner::m_getStatus() {
-  QueryStateData data{};
   LOG_D(TAG, "Enqueuing a GET_STATUS(0x41) request...");
-  this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
+  this->m_queueRequest(FrameType::DEVICE_QUERY, &this->m_statusQuery,
     // onData
     std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1)
   );
 }
 
+void AirConditioner::m_queueProperties(FrameData data, uint8_t id, OnPropertiesCallback onData, Handler onError) {
+  if (data.size() <= 3) {
+    LOG_W(TAG, "Empty 0x%02X properties request is ignored.", id);
+    return;
+  }
+  LOG_D(TAG, "Enqueuing a PROPERTIES(0x%02X) request...", id);
+  this->m_queueRequest(id == 0xB0 ? FrameType::DEVICE_CONTROL : FrameType::DEVICE_QUERY, std::move(data),
+    // onData
+    [id, onData](FrameData data) -> ResponseStatus {
+      if (!data.hasID(id))
+        return ResponseStatus::RESPONSE_WRONG;
+      if (onData != nullptr)
+        onData(PropertyData(data));
+      return ResponseStatus::RESPONSE_OK;
+    },
+    // onSuccess
+    nullptr,
+    // onError
+    [id, onError]() {
+      LOG_W(TAG, "Failed to %s properties: no 0x%02X response.", (id == 0xB0) ? "set" : "get", id);
+      if (onError != nullptr)
+        onError();
+    }
+  );
+}
+
 void AirConditioner::m_displayToggle() {
   DisplayToggleData data{};
   LOG_D(TAG, "Enqueuing a priority TOGGLE_LIGHT(0x41) request...");
@@ -191,38 +318,148 @@ void AirConditioner::m_displayToggle() {
 }
 
 template<typename T>
-void setProperty(T &property, const T &value, bool &update) {
+static void setProperty(T &property, const T &value, StateMask &changed, StateMask field) {
   if (property != value) {
     property = value;
-    update = true;
+    changed |= field;
   }
 }
 
 ResponseStatus AirConditioner::m_readStatus(FrameData data) {
   if (!data.hasStatus())
     return ResponseStatus::RESPONSE_WRONG;
-  LOG_D(TAG, "New status data received. Parsing...");
-  bool hasUpdate = false;
-  const StatusData newStatus = data.to<StatusData>();
-  this->m_status.copyStatus(newStatus);
-  if (this->m_mode != newStatus.getMode()) {
-    hasUpdate = true;
-    this->m_mode = newStatus.getMode();
-    if (newStatus.getMode() == Mode::MODE_OFF)
-      this->m_lastPreset = this->m_preset;
+  this->m_onStartupStep(STARTUP_STATUS);
+  StateMask changed = this->m_updateStatus(data.to<StatusData>()) | this->m_reportSensors();
+  if (this->m_state.stale) {
+    LOG_D(TAG, "Restored state is confirmed.");
+    this->m_state.stale = false;
+    changed |= FIELD_STALE;
   }
-  setProperty(this->m_preset, newStatus.getPreset(), hasUpdate);
-  setProperty(this->m_fanMode, newStatus.getFanMode(), hasUpdate);
-  setProperty(this->m_swingMode, newStatus.getSwingMode(), hasUpdate);
-  setProperty(this->m_targetTemp, newStatus.getTargetTemp(), hasUpdate);
-  setProperty(this->m_indoorTemp, newStatus.getIndoorTemp(), hasUpdate);
-  setProperty(this->m_outdoorTemp, newStatus.getOutdoorTemp(), hasUpdate);
-  setProperty(this->m_indoorHumidity, newStatus.getHumiditySetpoint(), hasUpdate);
-  if (hasUpdate)
-    this->sendUpdate();
+  if (changed & CONTROL_FIELDS)
+    this->m_saveState();
+  if (changed)
+    this->m_publishState(changed);
   return ResponseStatus::RESPONSE_OK;
 }
 
+StateMask AirConditioner::m_updateStatus(StatusData newStatus) {
+  // Only fields whose raw bits differ from previous status are decoded
+  const StateMask dirty = newStatus.diff(this->m_rawStatus);
+  // Settings bytes are always kept: untracked bits may be changed by remote or front panel
+  this->m_status.copyStatus(newStatus);
+  StateMask changed = 0;
+  if (dirty) {
+    LOG_D(TAG, "New status data received. Parsing...");
+    const StatusSnapshot status = newStatus.snapshot();
+    this->m_rawMode = status.rawMode;
+    if ((dirty & FIELD_MODE) && this->m_state.mode != status.mode) {
+      changed |= FIELD_MODE;
+      this->m_state.mode = status.mode;
+      if (status.mode == Mode::MODE_OFF)
+        this->m_lastPreset = this->m_state.preset;
+    }
+    if (dirty & FIELD_PRESET)
+      setProperty(this->m_state.preset, status.preset, changed, FIELD_PRESET);
+    if (dirty & FIELD_FAN_MODE)
+      setProperty(this->m_state.fanMode, status.fanMode, changed, FIELD_FAN_MODE);
+    if (dirty & FIELD_SWING_MODE)
+      setProperty(this->m_state.swingMode, status.swingMode, changed, FIELD_SWING_MODE);
+    if (dirty & FIELD_TARGET_TEMP)
+      setProperty(this->m_state.targetTemp, status.targetTemp, changed, FIELD_TARGET_TEMP);
+    if (dirty & FIELD_INDOOR_TEMP)
+      this->m_indoorTempFilter.put(status.indoorTemp);
+    if (dirty & FIELD_OUTDOOR_TEMP)
+      this->m_outdoorTempFilter.put(status.outdoorTemp);
+    if (dirty & FIELD_HUMIDITY)
+      this->m_humidityFilter.put(status.humiditySetpoint);
+  }
+  this->m_rawStatus = std::move(newStatus);
+  return changed;
+}
+
+// Warm start blob: version, last preset, status size, raw status, checksum
+static const uint8_t STATE_VERSION = 1;
+static const uint8_t STATE_MAX_STATUS = 40;
+static const uint8_t STATE_HEADER = 3;
+
+bool AirConditioner::m_loadState() {
+  if (this->m_storage == nullptr)
+    return false;
+  uint8_t blob[STATE_HEADER + STATE_MAX_STATUS + 1];
+  const size_t size = this->m_storage->load(STATE_KEY, blob, sizeof(blob));
+  if (size < STATE_HEADER + 1 || blob[0] != STATE_VERSION || size != STATE_HEADER + blob[2] + 1u ||
+      blobChecksum(blob, size - 1) != blob[size - 1])
+    return false;
+  const StatusData status(FrameData(blob + STATE_HEADER, blob[2]));
+  if (!status.hasStatus())
+    return false;
+  LOG_D(TAG, "Last state restored from storage.");
+  this->m_state.stale = true;
+  const StateMask changed = this->m_updateStatus(status) | FIELD_STALE | FIELD_INDOOR_TEMP | FIELD_OUTDOOR_TEMP |
+                            FIELD_HUMIDITY;
+  // Restored sensor values must not delay first real reading by min interval
+  this->m_indoorTempFilter.restore(this->m_state.indoorTemp);
+  this->m_outdoorTempFilter.restore(this->m_state.outdoorTemp);
+  this->m_humidityFilter.restore(this->m_state.indoorHumidity);
+  this->m_lastPreset = static_cast<Preset>(blob[1]);
+  this->m_publishState(changed);
+  return true;
+}
+
+void AirConditioner::m_saveState() {
+  if (!this->m_warmStart || this->m_storage == nullptr)
+    return;
+  const uint8_t size = this->m_rawStatus.size();
+  if (size > STATE_MAX_STATUS)
+    return;
+  uint8_t blob[STATE_HEADER + STATE_MAX_STATUS + 1];
+  blob[0] = STATE_VERSION;
+  blob[1] = this->m_lastPreset;
+  blob[2] = size;
+  memcpy(blob + STATE_HEADER, this->m_rawStatus.data(), size);
+  blob[STATE_HEADER + size] = blobChecksum(blob, STATE_HEADER + size);
+  if (!this->m_storage->save(STATE_KEY, blob, STATE_HEADER + size + 1))
+    LOG_W(TAG, "Failed to save state to storage.");
+}
+
+StateMask AirConditioner::m_reportSensors() {
+  const TimerTick now = this->m_timerManager.ms();
+  StateMask changed = 0;
+  if (this->m_indoorTempFilter.report(this->m_state.indoorTemp, now))
+    changed |= FIELD_INDOOR_TEMP;
+  if (this->m_outdoorTempFilter.report(this->m_state.outdoorTemp, now))
+    changed |= FIELD_OUTDOOR_TEMP;
+  if (this->m_humidityFilter.report(this->m_state.indoorHumidity, now))
+    changed |= FIELD_HUMIDITY;
+  if (this->m_powerUsageFilter.report(this->m_state.powerUsage, now))
+    changed |= FIELD_POWER_USAGE;
+  return changed;
+}
+
+void AirConditioner::setSensorFilter(StateField field, float deadband, uint32_t minInterval) {
+  switch (field) {
+    case FIELD_INDOOR_TEMP:
+      this->m_indoorTempFilter.setDeadband(floatToTemp10(deadband));
+      this->m_indoorTempFilter.setMinInterval(minInterval);
+      break;
+    case FIELD_OUTDOOR_TEMP:
+      this->m_outdoorTempFilter.setDeadband(floatToTemp10(deadband));
+      this->m_outdoorTempFilter.setMinInterval(minInterval);
+      break;
+    case FIELD_HUMIDITY:
+      this->m_humidityFilter.setDeadband(static_cast<uint8_t>(deadband));
+      this->m_humidityFilter.setMinInterval(minInterval);
+      break;
+    case FIELD_POWER_USAGE:
+      this->m_powerUsageFilter.setDeadband(deadband);
+      this->m_powerUsageFilter.setMinInterval(minInterval);
+      break;
+    default:
+      LOG_W(TAG, "Field 0x%X is not a sensor field. Filter is ignored.", field);
+      break;
+  }
+}
+
 }  // namespace ac
 }  // namespace midea
 }  // namespace dudanov
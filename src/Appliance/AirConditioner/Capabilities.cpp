@@ -1,6 +1,9 @@
 #include "Appliance/AirConditioner/Capabilities.h"
 #include "Frame/FrameData.h"
 #include "Helpers/Log.h"
+#include "Helpers/Storage.h"
+#include <algorithm>
+#include <iterator>
 
 namespace dudanov {
 namespace midea {
@@ -8,31 +11,6 @@ namespace ac {
 
 static const char *TAG = "Capabilities";
 
-enum CapabilityID : uint16_t {
-  CAPABILITY_INDOOR_HUMIDITY = 0x0015,
-  CAPABILITY_SILKY_COOL = 0x0018,
-  CAPABILITY_SMART_EYE = 0x0030,
-  CAPABILITY_WIND_ON_ME = 0x0032,
-  CAPABILITY_WIND_OF_ME = 0x0033,
-  CAPABILITY_ACTIVE_CLEAN = 0x0039,
-  CAPABILITY_ONE_KEY_NO_WIND_ON_ME = 0x0042,
-  CAPABILITY_BREEZE_CONTROL = 0x0043,
-  CAPABILITY_FAN_SPEED_CONTROL = 0x0210,
-  CAPABILITY_PRESET_ECO = 0x0212,
-  CAPABILITY_PRESET_FREEZE_PROTECTION = 0x0213,
-  CAPABILITY_MODES = 0x0214,
-  CAPABILITY_SWING_MODES = 0x0215,
-  CAPABILITY_POWER = 0x0216,
-  CAPABILITY_NEST = 0x0217,
-  CAPABILITY_AUX_ELECTRIC_HEATING = 0x0219,
-  CAPABILITY_PRESET_TURBO = 0x021A,
-  CAPABILITY_HUMIDITY = 0x021F,
-  CAPABILITY_UNIT_CHANGEABLE = 0x0222,
-  CAPABILITY_LIGHT_CONTROL = 0x0224,
-  CAPABILITY_TEMPERATURES = 0x0225,
-  CAPABILITY_BUZZER = 0x022C,
-};
-
 static uint16_t read_u16(const uint8_t *data) { return (data[1] << 8) | data[0]; }
 
 class CapabilityData {
@@ -66,6 +44,66 @@ class CapabilityData {
   uint8_t m_num;
 };
 
+static_assert(CAP_NUM <= 32, "Capability flags do not fit the bitset");
+
+// Flag descriptor. Flag is set if bit of capability value is set in `values` mask
+// (values above 7 use bit 7). If `limit` is non-zero, values >= `limit` leave flag unchanged.
+struct CapabilityDescriptor {
+  CapabilityID id;
+  CapabilityFlag flag;
+  uint8_t values;
+  uint8_t limit;
+  const char *name;
+};
+
+static constexpr uint8_t ANY = 0xFE;
+static constexpr uint8_t ZERO = 1 << 0;
+static constexpr uint8_t ONE = 1 << 1;
+static constexpr uint8_t TWO = 1 << 2;
+static constexpr uint8_t NOT_ONE = 0xFF & ~ONE;
+
+// Sorted by ID for binary search
+static constexpr CapabilityDescriptor CAPABILITIES[] = {
+  {CAPABILITY_INDOOR_HUMIDITY, CAP_INDOOR_HUMIDITY, ANY, 0, "INDOOR HUMIDITY"},
+  {CAPABILITY_SILKY_COOL, CAP_SILKY_COOL, ANY, 0, "SILKY COOL"},
+  {CAPABILITY_SMART_EYE, CAP_SMART_EYE, ONE, 0, "SMART EYE"},
+  {CAPABILITY_WIND_ON_ME, CAP_WIND_ON_ME, ONE, 0, "WIND ON ME"},
+  {CAPABILITY_WIND_OF_ME, CAP_WIND_OF_ME, ONE, 0, "WIND OF ME"},
+  {CAPABILITY_ACTIVE_CLEAN, CAP_ACTIVE_CLEAN, ONE, 0, "ACTIVE CLEAN"},
+  {CAPABILITY_ONE_KEY_NO_WIND_ON_ME, CAP_ONE_KEY_NO_WIND_ON_ME, ONE, 0, "ONE KEY NO WIND ON ME"},
+  {CAPABILITY_BREEZE_CONTROL, CAP_BREEZE_CONTROL, ONE, 0, "BREEZE CONTROL"},
+  {CAPABILITY_FAN_SPEED_CONTROL, CAP_FAN_SPEED_CONTROL, NOT_ONE, 0, "FANSPEED CONTROL"},
+  {CAPABILITY_PRESET_ECO, CAP_ECO_MODE, ONE, 0, "ECO MODE"},
+  {CAPABILITY_PRESET_ECO, CAP_SPECIAL_ECO, TWO, 0, "SPECIAL ECO"},
+  {CAPABILITY_PRESET_FREEZE_PROTECTION, CAP_FROST_PROTECTION_MODE, ONE, 0, "FROST PROTECTION MODE"},
+  {CAPABILITY_MODES, CAP_AUTO_MODE, 0b0111, 4, "AUTO MODE"},
+  {CAPABILITY_MODES, CAP_COOL_MODE, 0b1011, 4, "COOL MODE"},
+  {CAPABILITY_MODES, CAP_HEAT_MODE, 0b0110, 4, "HEAT MODE"},
+  {CAPABILITY_MODES, CAP_DRY_MODE, 0b0011, 4, "DRY MODE"},
+  {CAPABILITY_SWING_MODES, CAP_UPDOWN_FAN, 0b0011, 4, "UPDOWN FAN"},
+  {CAPABILITY_SWING_MODES, CAP_LEFTRIGHT_FAN, 0b1010, 4, "LEFTRIGHT FAN"},
+  {CAPABILITY_POWER, CAP_POWER_CAL, 0b1100, 4, "POWER CAL"},
+  {CAPABILITY_POWER, CAP_POWER_CAL_SETTING, 0b1000, 4, "POWER CAL SETTING"},
+  {CAPABILITY_NEST, CAP_NEST_CHECK, 0b10110, 5, "NEST CHECK"},
+  {CAPABILITY_NEST, CAP_NEST_NEED_CHANGE, 0b11000, 5, "NEST NEED CHANGE"},
+  {CAPABILITY_AUX_ELECTRIC_HEATING, CAP_ELECTRIC_AUX_HEATING, ANY, 0, "ELECTRIC AUX HEATING"},
+  {CAPABILITY_PRESET_TURBO, CAP_TURBO_COOL, 0b0011, 4, "TURBO COOL"},
+  {CAPABILITY_PRESET_TURBO, CAP_TURBO_HEAT, 0b1010, 4, "TURBO HEAT"},
+  {CAPABILITY_HUMIDITY, CAP_AUTO_SET_HUMIDITY, 0b0110, 4, "AUTO SET HUMIDITY"},
+  {CAPABILITY_HUMIDITY, CAP_MANUAL_SET_HUMIDITY, 0b1100, 4, "MANUAL SET HUMIDITY"},
+  {CAPABILITY_UNIT_CHANGEABLE, CAP_UNIT_CHANGEABLE, ZERO, 0, "UNIT CHANGEABLE"},
+  {CAPABILITY_LIGHT_CONTROL, CAP_LIGHT_CONTROL, ANY, 0, "LIGHT CONTROL"},
+  {CAPABILITY_BUZZER, CAP_BUZZER, ANY, 0, "BUZZER"},
+};
+
+static constexpr size_t CAPABILITIES_NUM = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+static constexpr bool isSorted(size_t n = 1) {
+  return n >= CAPABILITIES_NUM || (CAPABILITIES[n - 1].id <= CAPABILITIES[n].id && isSorted(n + 1));
+}
+
+static_assert(isSorted(), "CAPABILITIES must be sorted by ID");
+
 bool Capabilities::read(const FrameData &frame) {
   if (frame.size() < 14)
     return false;
@@ -75,193 +113,22 @@ bool Capabilities::read(const FrameData &frame) {
   for (; cap.isValid(); cap.advance()) {
     if (!cap.size())
       continue;
+    const CapabilityID id = cap.id();
     const uint8_t uval = cap[0];
-    const bool bval = uval;
-    switch (cap.id()) {
-      case CAPABILITY_INDOOR_HUMIDITY:
-        this->m_indoorHumidity = bval;
-        break;
-      case CAPABILITY_SILKY_COOL:
-        this->m_silkyCool = bval;
-        break;
-      case CAPABILITY_SMART_EYE:
-        this->m_smartEye = uval == 1;
-        break;
-      case CAPABILITY_WIND_ON_ME:
-        this->m_windOnMe = uval == 1;
-        break;
-      case CAPABILITY_WIND_OF_ME:
-        this->m_windOfMe = uval == 1;
-        break;
-      case CAPABILITY_ACTIVE_CLEAN:
-        this->m_activeClean = uval == 1;
-        break;
-      case CAPABILITY_ONE_KEY_NO_WIND_ON_ME:
-        this->m_oneKeyNoWindOnMe = uval == 1;
-        break;
-      case CAPABILITY_BREEZE_CONTROL:
-        this->m_breezeControl = uval == 1;
-        break;
-      case CAPABILITY_FAN_SPEED_CONTROL:
-        this->m_fanSpeedControl = uval != 1;
-        break;
-      case CAPABILITY_PRESET_ECO:
-        this->m_ecoMode = uval == 1;
-        this->m_specialEco = uval == 2;
-        break;
-      case CAPABILITY_PRESET_FREEZE_PROTECTION:
-        this->m_frostProtectionMode = uval == 1;
-        break;
-      case CAPABILITY_MODES:
-        switch (uval) {
-          case 0:
-            this->m_heatMode = false;
-            this->m_coolMode = true;
-            this->m_dryMode = true;
-            this->m_autoMode = true;
-            break;
-          case 1:
-            this->m_coolMode = true;
-            this->m_heatMode= true;
-            this->m_dryMode = true;
-            this->m_autoMode = true;
-            break;
-          case 2:
-            this->m_coolMode = false;
-            this->m_dryMode = false;
-            this->m_heatMode = true;
-            this->m_autoMode = true;
-            break;
-          case 3:
-            this->m_coolMode = true;
-            this->m_dryMode = false;
-            this->m_heatMode = false;
-            this->m_autoMode = false;
-            break;
-        }
-        break;
-      case CAPABILITY_SWING_MODES:
-        switch (uval) {
-          case 0:
-            this->m_leftrightFan = false;
-            this->m_updownFan = true;
-            break;
-          case 1:
-            this->m_leftrightFan = true;
-            this->m_updownFan = true;
-            break;
-          case 2:
-            this->m_leftrightFan = false;
-            this->m_updownFan = false;
-            break;
-          case 3:
-            this->m_leftrightFan = true;
-            this->m_updownFan = false;
-            break;
-        }
-        break;
-      case CAPABILITY_POWER:
-        switch (uval) {
-          case 0:
-          case 1:
-            this->m_powerCal = false;
-            this->m_powerCalSetting = false;
-            break;
-          case 2:
-            this->m_powerCal = true;
-            this->m_powerCalSetting = false;
-            break;
-          case 3:
-            this->m_powerCal = true;
-            this->m_powerCalSetting = true;
-            break;
-        }
-        break;
-      case CAPABILITY_NEST:
-        switch (uval) {
-          case 0:
-            this->m_nestCheck = false;
-            this->m_nestNeedChange = false;
-            break;
-          case 1:
-          case 2:
-            this->m_nestCheck = true;
-            this->m_nestNeedChange = false;
-            break;
-          case 3:
-            this->m_nestCheck = false;
-            this->m_nestNeedChange = true;
-            break;
-          case 4:
-            this->m_nestCheck = true;
-            this->m_nestNeedChange = true;
-            break;
-        }
-        break;
-      case CAPABILITY_AUX_ELECTRIC_HEATING:
-        this->m_electricAuxHeating = bval;
-        break;
-      case CAPABILITY_PRESET_TURBO:
-        switch (uval) {
-          case 0:
-            this->m_turboHeat = false;
-            this->m_turboCool = true;
-            break;
-          case 1:
-            this->m_turboHeat = true;
-            this->m_turboCool = true;
-            break;
-          case 2:
-            this->m_turboHeat = false;
-            this->m_turboCool = false;
-            break;
-           case 3:
-            this->m_turboHeat = true;
-            this->m_turboCool = false;
-            break;
-        }
-        break;
-      case CAPABILITY_HUMIDITY:
-        switch (uval) {
-          case 0:
-            this->m_autoSetHumidity = false;
-            this->m_manualSetHumidity = false;
-            break;
-          case 1:
-            this->m_autoSetHumidity = true;
-            this->m_manualSetHumidity = false;
-            break;
-          case 2:
-            this->m_autoSetHumidity = true;
-            this->m_manualSetHumidity = true;
-            break;
-          case 3:
-            this->m_autoSetHumidity = false;
-            this->m_manualSetHumidity = true;
-            break;
-        }
-        break;
-      case CAPABILITY_UNIT_CHANGEABLE:
-        this->m_unitChangeable = !bval;
-        break;
-      case CAPABILITY_LIGHT_CONTROL:
-        this->m_lightControl = bval;
-        break;
-      case CAPABILITY_TEMPERATURES:
-        if (cap.size() >= 6) {
-          this->m_minTempCool = static_cast<float>(uval) * 0.5f;
-          this->m_maxTempCool = static_cast<float>(cap[1]) * 0.5f;
-          this->m_minTempAuto = static_cast<float>(cap[2]) * 0.5f;
-          this->m_maxTempAuto = static_cast<float>(cap[3]) * 0.5f;
-          this->m_minTempHeat = static_cast<float>(cap[4]) * 0.5f;
-          this->m_maxTempHeat = static_cast<float>(cap[5]) * 0.5f;
-          this->m_decimals = (cap.size() > 6) ? cap[6] : cap[2];
-        }
-        break;
-      case CAPABILITY_BUZZER:
-        this->m_buzzer = bval;
-        break;
+    if (id == CAPABILITY_TEMPERATURES) {
+      if (cap.size() >= 6) {
+        for (uint8_t idx = 0; idx < TEMP_NUM; ++idx)
+          this->m_temps[idx] = cap[idx];
+        this->m_setFlag(CAP_DECIMALS, (cap.size() > 6) ? cap[6] : cap[2]);
+      }
+      continue;
     }
+    const uint8_t bit = 1 << ((uval < 7) ? uval : 7);
+    auto desc = std::lower_bound(std::begin(CAPABILITIES), std::end(CAPABILITIES), id,
+                                 [](const CapabilityDescriptor &desc, CapabilityID id) { return desc.id < id; });
+    for (; desc != std::end(CAPABILITIES) && desc->id == id; ++desc)
+      if (!desc->limit || uval < desc->limit)
+        this->m_setFlag(desc->flag, desc->values & bit);
   }
 
   // Как минимум указывает на предпоследний элемент (минимум 2 непрочитанных байта)
@@ -271,55 +138,44 @@ bool Capabilities::read(const FrameData &frame) {
   return false;
 }
 
-#define LOG_CAPABILITY(str, condition) \
-  if (condition) \
-    LOG_CONFIG(TAG, str);
+// Version of serialized blob
+static const uint8_t BLOB_VERSION = 1;
+
+void Capabilities::serialize(uint8_t *data) const {
+  static_assert(BLOB_SIZE == 6 + TEMP_NUM, "Wrong capabilities blob size");
+  data[0] = BLOB_VERSION;
+  for (uint8_t n = 0; n < 4; ++n)
+    data[1 + n] = this->m_flags >> (8 * n);
+  memcpy(data + 5, this->m_temps, TEMP_NUM);
+  data[BLOB_SIZE - 1] = blobChecksum(data, BLOB_SIZE - 1);
+}
+
+bool Capabilities::deserialize(const uint8_t *data, size_t size) {
+  if (size != BLOB_SIZE || data[0] != BLOB_VERSION || blobChecksum(data, BLOB_SIZE - 1) != data[BLOB_SIZE - 1])
+    return false;
+  this->m_flags = 0;
+  for (uint8_t n = 0; n < 4; ++n)
+    this->m_flags |= static_cast<uint32_t>(data[1 + n]) << (8 * n);
+  memcpy(this->m_temps, data + 5, TEMP_NUM);
+  return true;
+}
+
+#define LOG_CAPABILITY_TEMPS(mode, min, max) \
+  LOG_CONFIG(TAG, "  " mode " TEMPS: %d.%d - %d.%d", (min) / 10, (min) % 10, (max) / 10, (max) % 10)
 
 void Capabilities::dump() const {
   LOG_CONFIG(TAG, "CAPABILITIES REPORT:");
-  if (this->m_autoMode) {
-    LOG_CONFIG(TAG, "  [x] AUTO MODE");
-    LOG_CONFIG(TAG, "      - MIN TEMP: %.1f", this->m_minTempAuto);
-    LOG_CONFIG(TAG, "      - MAX TEMP: %.1f", this->m_maxTempAuto);
-  }
-  if (this->m_coolMode) {
-    LOG_CONFIG(TAG, "  [x] COOL MODE");
-    LOG_CONFIG(TAG, "      - MIN TEMP: %.1f", this->m_minTempCool);
-    LOG_CONFIG(TAG, "      - MAX TEMP: %.1f", this->m_maxTempCool);
-  }
-  if (this->m_heatMode) {
-    LOG_CONFIG(TAG, "  [x] HEAT MODE");
-    LOG_CONFIG(TAG, "      - MIN TEMP: %.1f", this->m_minTempHeat);
-    LOG_CONFIG(TAG, "      - MAX TEMP: %.1f", this->m_maxTempHeat);
-  }
-  LOG_CAPABILITY("  [x] DRY MODE", this->m_dryMode);
-  LOG_CAPABILITY("  [x] ECO MODE", this->m_ecoMode);
-  LOG_CAPABILITY("  [x] SPECIAL ECO", this->m_specialEco);
-  LOG_CAPABILITY("  [x] FROST PROTECTION MODE", this->m_frostProtectionMode);
-  LOG_CAPABILITY("  [x] TURBO COOL", this->m_turboCool);
-  LOG_CAPABILITY("  [x] TURBO HEAT", this->m_turboHeat);
-  LOG_CAPABILITY("  [x] FANSPEED CONTROL", this->m_fanSpeedControl);
-  LOG_CAPABILITY("  [x] BREEZE CONTROL", this->m_breezeControl);
-  LOG_CAPABILITY("  [x] LIGHT CONTROL", this->m_lightControl);
-  LOG_CAPABILITY("  [x] UPDOWN FAN", this->m_updownFan);
-  LOG_CAPABILITY("  [x] LEFTRIGHT FAN", this->m_leftrightFan);
-  LOG_CAPABILITY("  [x] AUTO SET HUMIDITY", this->m_autoSetHumidity);
-  LOG_CAPABILITY("  [x] MANUAL SET HUMIDITY", this->m_manualSetHumidity);
-  LOG_CAPABILITY("  [x] INDOOR HUMIDITY", this->m_indoorHumidity);
-  LOG_CAPABILITY("  [x] POWER CAL", this->m_powerCal);
-  LOG_CAPABILITY("  [x] POWER CAL SETTING", this->m_powerCalSetting);
-  LOG_CAPABILITY("  [x] BUZZER", this->m_buzzer);
-  LOG_CAPABILITY("  [x] ACTIVE CLEAN", this->m_activeClean);
-  LOG_CAPABILITY("  [x] DECIMALS", this->m_decimals);
-  LOG_CAPABILITY("  [x] ELECTRIC AUX HEATING", this->m_electricAuxHeating);
-  LOG_CAPABILITY("  [x] NEST CHECK", this->m_nestCheck);
-  LOG_CAPABILITY("  [x] NEST NEED CHANGE", this->m_nestNeedChange);
-  LOG_CAPABILITY("  [x] ONE KEY NO WIND ON ME", this->m_oneKeyNoWindOnMe);
-  LOG_CAPABILITY("  [x] SILKY COOL", this->m_silkyCool);
-  LOG_CAPABILITY("  [x] SMART EYE", this->m_smartEye);
-  LOG_CAPABILITY("  [x] UNIT CHANGEABLE", this->m_unitChangeable);
-  LOG_CAPABILITY("  [x] WIND OF ME", this->m_windOfMe);
-  LOG_CAPABILITY("  [x] WIND ON ME", this->m_windOnMe);
+  for (const auto &desc : CAPABILITIES)
+    if (this->has(desc.flag))
+      LOG_CONFIG(TAG, "  [x] %s", desc.name);
+  if (this->has(CAP_AUTO_MODE))
+    LOG_CAPABILITY_TEMPS("AUTO", this->minTempAuto10(), this->maxTempAuto10());
+  if (this->has(CAP_COOL_MODE))
+    LOG_CAPABILITY_TEMPS("COOL", this->minTempCool10(), this->maxTempCool10());
+  if (this->has(CAP_HEAT_MODE))
+    LOG_CAPABILITY_TEMPS("HEAT", this->minTempHeat10(), this->maxTempHeat10());
+  if (this->has(CAP_DECIMALS))
+    LOG_CONFIG(TAG, "  [x] DECIMALS");
 }
 
 }  // namespace ac
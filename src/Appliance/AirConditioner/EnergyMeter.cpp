@@ -0,0 +1,41 @@
+#include "Appliance/AirConditioner/EnergyMeter.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+// Energy counter has 8 BCD digits
+static const uint32_t COUNTER_WRAP = 100000000;
+// Counter decrease from values above this threshold is considered as wrap, otherwise as reset
+static const uint32_t COUNTER_WRAP_THRESHOLD = COUNTER_WRAP / 10 * 9;
+// Energy of one counter step (Wh)
+static const uint32_t COUNTER_STEP = 10;
+// One Wh in tenths of W * ms
+static const uint64_t WH_UNITS = 10ULL * 3600 * 1000;
+
+void EnergyMeter::update(uint32_t counter, uint32_t power10, TimerTick now) {
+  if (counter || this->m_hasCounter) {
+    if (this->m_hasCounter) {
+      uint32_t delta = counter - this->m_counter;
+      if (counter < this->m_counter)
+        delta = (this->m_counter >= COUNTER_WRAP_THRESHOLD) ? (counter + COUNTER_WRAP - this->m_counter) : counter;
+      this->m_energy += delta * COUNTER_STEP;
+    }
+    this->m_counter = counter;
+    this->m_hasCounter = true;
+  } else {
+    if (this->m_hasPower) {
+      // trapezoidal integration between reports
+      this->m_remainder += static_cast<uint64_t>(this->m_power10 + power10) * (now - this->m_lastTime) / 2;
+      this->m_energy += this->m_remainder / WH_UNITS;
+      this->m_remainder %= WH_UNITS;
+    }
+    this->m_hasPower = true;
+  }
+  this->m_power10 = power10;
+  this->m_lastTime = now;
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,47 @@
+#include "Appliance/AirConditioner/Properties.h"
+#include "Frame/Frame.h"
+#include "Helpers/Log.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+static const char *TAG = "Properties";
+
+// Frame length field is one byte
+static const size_t MAX_PAYLOAD_SIZE = 255 - Frame::OFFSET_DATA;
+
+static bool checkSize(const FrameData &frame, size_t size, uint16_t id) {
+  if (frame.size() + size <= MAX_PAYLOAD_SIZE)
+    return true;
+  LOG_W(TAG, "Property 0x%04X does not fit into frame and is ignored. Split batch into several requests.", id);
+  return false;
+}
+
+GetPropertiesData &GetPropertiesData::add(uint16_t id) {
+  if (!checkSize(*this, 2, id))
+    return *this;
+  this->m_data.pop_back();
+  this->m_data.push_back(id & 0xFF);
+  this->m_data.push_back(id >> 8);
+  ++this->m_data[1];
+  this->appendCRC();
+  return *this;
+}
+
+SetPropertiesData &SetPropertiesData::add(uint16_t id, const uint8_t *data, uint8_t size) {
+  if (!checkSize(*this, 3 + size, id))
+    return *this;
+  this->m_data.pop_back();
+  this->m_data.push_back(id & 0xFF);
+  this->m_data.push_back(id >> 8);
+  this->m_data.push_back(size);
+  this->m_data.insert(this->m_data.end(), data, data + size);
+  ++this->m_data[1];
+  this->appendCRC();
+  return *this;
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
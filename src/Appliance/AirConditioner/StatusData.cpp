@@ -4,19 +4,48 @@ namespace dudanov {
 namespace midea {
 namespace ac {
 
-float StatusData::getTargetTemp() const {
-  uint8_t tmp = this->m_getValue(2, 15) + 16;
-  uint8_t tmpNew = this->m_getValue(13, 31);
-  if (tmpNew)
-    tmp = tmpNew + 12;
-  float temp = static_cast<float>(tmp);
-  if (this->m_getValue(2, 16))
-    temp += 0.5F;
-  return temp;
+struct FieldBits {
+  uint32_t field;
+  uint8_t idx;
+  uint8_t mask;
+};
+
+// Raw bits each decoded field depends on
+static const FieldBits FIELD_BITS[] = {
+  {FIELD_MODE, 1, 0x01},
+  {FIELD_MODE, 2, 0xE0},
+  {FIELD_PRESET, 8, 0x20},
+  {FIELD_PRESET, 9, 0x10},
+  {FIELD_PRESET, 10, 0x03},
+  {FIELD_PRESET, 21, 0x80},
+  {FIELD_FAN_MODE, 3, 0xFF},
+  {FIELD_SWING_MODE, 7, 0x0F},
+  {FIELD_TARGET_TEMP, 2, 0x1F},
+  {FIELD_TARGET_TEMP, 13, 0x1F},
+  {FIELD_INDOOR_TEMP, 10, 0x04},
+  {FIELD_INDOOR_TEMP, 11, 0xFF},
+  {FIELD_INDOOR_TEMP, 15, 0x0F},
+  {FIELD_OUTDOOR_TEMP, 10, 0x04},
+  {FIELD_OUTDOOR_TEMP, 12, 0xFF},
+  {FIELD_OUTDOOR_TEMP, 15, 0xF0},
+  {FIELD_HUMIDITY, 19, 0x7F},
+};
+
+uint32_t StatusData::diff(const StatusData &prev) const {
+  if (this->size() != prev.size())
+    return UINT32_MAX;
+  if (!memcmp(this->data(), prev.data(), this->size()))
+    return 0;
+  uint32_t mask = 0;
+  for (const auto &bits : FIELD_BITS)
+    if ((this->m_getValue(bits.idx) ^ prev.m_getValue(bits.idx)) & bits.mask)
+      mask |= bits.field;
+  return mask;
 }
 
-void StatusData::setTargetTemp(float temp) {
-  uint8_t tmp = static_cast<uint8_t>(temp * 4.0F) + 1;
+void StatusData::setTargetTemp10(Temp10 temp) {
+  // quarters of degree
+  uint8_t tmp = static_cast<uint8_t>(temp * 2 / 5) + 1;
   uint8_t integer = tmp / 4;
   this->m_setValue(18, integer - 12, 31);
   integer -= 16;
@@ -25,19 +54,14 @@ void StatusData::setTargetTemp(float temp) {
   this->m_setValue(2, ((tmp & 2) << 3) | integer, 31);
 }
 
-static float getTemp(int integer, int decimal, bool fahrenheits) {
+static Temp10 getTemp(int integer, int decimal, bool fahrenheits) {
   integer -= 50;
   if (!fahrenheits && decimal > 0)
-    return static_cast<float>(integer / 2) + static_cast<float>(decimal) * ((integer >= 0) ? 0.1F : -0.1F);
+    return integer / 2 * 10 + ((integer >= 0) ? decimal : -decimal);
   if (decimal >= 5)
-    return static_cast<float>(integer / 2) + ((integer >= 0) ? 0.5F : -0.5F);
-  return static_cast<float>(integer) * 0.5F;
+    return integer / 2 * 10 + ((integer >= 0) ? 5 : -5);
+  return integer * 5;
 }
-float StatusData::getIndoorTemp() const { return getTemp(this->m_getValue(11), this->m_getValue(15, 15), this->isFahrenheits()); }
-float StatusData::getOutdoorTemp() const { return getTemp(this->m_getValue(12), this->m_getValue(15, 15, 4), this->isFahrenheits()); }
-float StatusData::getHumiditySetpoint() const { return static_cast<float>(this->m_getValue(19, 127)); }
-
-Mode StatusData::getMode() const { return this->m_getPower() ? this->getRawMode() : Mode::MODE_OFF; }
 
 void StatusData::setMode(Mode mode) {
   if (mode != Mode::MODE_OFF) {
@@ -48,29 +72,71 @@ void StatusData::setMode(Mode mode) {
   }
 }
 
-FanMode StatusData::getFanMode() const {
-  //some ACs return 30 for LOW and 50 for MEDIUM. Note though, in appMode, this device still uses 40/60
-  uint8_t fanMode = this->m_getValue(3);
-  if (fanMode == 30) {
-    fanMode = FAN_LOW;
-  } else if (fanMode == 50) {
-    fanMode = FAN_MEDIUM;
-  }
-  return static_cast<FanMode>(fanMode); 
+static Temp10 decodeTargetTemp(uint8_t b2, uint8_t b13) {
+  const uint8_t tmpNew = b13 & 31;
+  Temp10 temp = 10 * (tmpNew ? (tmpNew + 12) : ((b2 & 15) + 16));
+  if (b2 & 16)
+    temp += 5;
+  return temp;
 }
 
-Preset StatusData::getPreset() const {
-  if (this->m_getEco())
+static FanMode decodeFanMode(uint8_t b3) {
+  // some ACs return 30 for LOW and 50 for MEDIUM. Note though, in appMode, this device still uses 40/60
+  if (b3 == 30)
+    return FanMode::FAN_LOW;
+  if (b3 == 50)
+    return FanMode::FAN_MEDIUM;
+  return static_cast<FanMode>(b3);
+}
+
+static Preset decodePreset(uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b21) {
+  if (b9 & 16)
     return Preset::PRESET_ECO;
-  if (this->m_getTurbo())
+  if ((b8 & 32) || (b10 & 2))
     return Preset::PRESET_TURBO;
-  if (this->m_getSleep())
+  if (b10 & 1)
     return Preset::PRESET_SLEEP;
-  if (this->m_getFreezeProtection())
+  if (b21 & 128)
     return Preset::PRESET_FREEZE_PROTECTION;
   return Preset::PRESET_NONE;
 }
 
+Temp10 StatusData::getTargetTemp10() const { return decodeTargetTemp(this->m_getValue(2), this->m_getValue(13)); }
+FanMode StatusData::getFanMode() const { return decodeFanMode(this->m_getValue(3)); }
+Temp10 StatusData::getIndoorTemp10() const {
+  return getTemp(this->m_getValue(11), this->m_getValue(15, 15), this->isFahrenheits());
+}
+Temp10 StatusData::getOutdoorTemp10() const {
+  return getTemp(this->m_getValue(12), this->m_getValue(15, 15, 4), this->isFahrenheits());
+}
+Preset StatusData::getPreset() const {
+  return decodePreset(this->m_getValue(8), this->m_getValue(9), this->m_getValue(10), this->m_getValue(21));
+}
+
+// Minimal size of status payload with all decoded fields
+static const uint8_t STATUS_SIZE = 22;
+
+StatusSnapshot StatusData::snapshot() const {
+  uint8_t buf[STATUS_SIZE]{};
+  const uint8_t *p = this->data();
+  if (this->size() < STATUS_SIZE) {
+    memcpy(buf, p, this->size());
+    p = buf;
+  }
+  StatusSnapshot s;
+  s.rawMode = static_cast<Mode>(p[2] >> 5);
+  s.mode = (p[1] & 1) ? s.rawMode : Mode::MODE_OFF;
+  s.fanMode = decodeFanMode(p[3]);
+  s.swingMode = static_cast<SwingMode>(p[7] & 15);
+  s.targetTemp = decodeTargetTemp(p[2], p[13]);
+  s.fahrenheits = p[10] & 4;
+  s.indoorTemp = getTemp(p[11], p[15] & 15, s.fahrenheits);
+  s.outdoorTemp = getTemp(p[12], p[15] >> 4, s.fahrenheits);
+  s.humiditySetpoint = p[19] & 127;
+  s.preset = decodePreset(p[8], p[9], p[10], p[21]);
+  return s;
+}
+
 void StatusData::setPreset(Preset preset) {
   this->m_setEco(false);
   this->m_setSleep(false);
@@ -98,6 +164,13 @@ void StatusData::setPreset(Preset preset) {
 
 static uint8_t bcd2u8(uint8_t bcd) { return 10 * (bcd >> 4) + (bcd & 15); }
 
+uint32_t PowerData::m_getBCD(uint8_t idx, uint8_t num) const {
+  uint32_t value = 0;
+  for (; num; --num, ++idx)
+    value = 100 * value + bcd2u8(this->m_getValue(idx));
+  return value;
+}
+
 float StatusData::getPowerUsage() const {
   uint32_t power = 0;
   const uint8_t *ptr = this->m_data.data() + 18;
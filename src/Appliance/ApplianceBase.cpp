@@ -1,5 +1,9 @@
 #include "Appliance/ApplianceBase.h"
 #include "Helpers/Log.h"
+#include <algorithm>
+#if MIDEA_HAS_THREADS && !defined(ARDUINO)
+#include <sys/select.h>
+#endif
 
 #ifdef ARDUINO
   #ifdef ARDUINO_ARCH_ESP32
@@ -8,7 +12,7 @@
     #include <ESP8266WiFi.h>
   #endif
   #define HAS_WIFI 1
-#else
+#elif defined(ESP_PLATFORM)
   // ESP-IDF
   #include "esp_wifi.h"
   #include "esp_netif.h"
@@ -20,6 +24,17 @@ namespace midea {
 
 static const char *TAG = "ApplianceBase";
 
+#if MIDEA_ALLOC_TRACKING
+// Allocation sites
+static const char *const ALLOC_TIMERS = "ApplianceBase::loop/timers";
+static const char *const ALLOC_APPLIANCE = "ApplianceBase::loop/appliance";
+static const char *const ALLOC_RX = "ApplianceBase::loop/rx";
+static const char *const ALLOC_HANDLER = "ApplianceBase::loop/handler";
+static const char *const ALLOC_IDLE = "ApplianceBase::loop/idle";
+static const char *const ALLOC_TX = "ApplianceBase::loop/tx";
+static const char *const ALLOC_QUEUE = "ApplianceBase::m_queueRequest";
+#endif
+
 ResponseStatus ApplianceBase::Request::callHandler(const Frame &frame) {
   if (!frame.hasType(this->requestType))
     return ResponseStatus::RESPONSE_WRONG;
@@ -28,77 +43,285 @@ ResponseStatus ApplianceBase::Request::callHandler(const Frame &frame) {
   return this->onData(frame.getData());
 }
 
+bool ApplianceBase::FrameReceiver::m_feed(uint8_t data) {
+  const uint8_t length = this->m_data.size();
+  if (length == OFFSET_START && data != START_BYTE)
+    return false;
+  if (length == OFFSET_LENGTH && data <= OFFSET_DATA) {
+    this->m_data.clear();
+    return false;
+  }
+  this->m_data.push_back(data);
+  if (length > OFFSET_DATA && length >= this->m_data[OFFSET_LENGTH]) {
+    if (this->isValid()) {
+      if (!this->hasType(NETWORK_NOTIFY) && !this->hasType(QUERY_NETWORK) &&
+          FrameData::calcCRC(this->data() + OFFSET_DATA, this->m_len() - OFFSET_DATA))
+        this->m_metrics->crcErrors.inc();
+      return true;
+    }
+    this->m_metrics->checksumErrors.inc();
+    this->m_data.clear();
+  }
+  return false;
+}
+
 bool ApplianceBase::FrameReceiver::read(Stream *stream) {
-  while (stream->available()) {
-    const uint8_t data = stream->read();
-    const uint8_t length = this->m_data.size();
-    if (length == OFFSET_START && data != START_BYTE)
-      continue;
-    if (length == OFFSET_LENGTH && data <= OFFSET_DATA) {
-      this->m_data.clear();
+  while (stream->available())
+    if (this->m_feed(stream->read()))
+      return true;
+  return false;
+}
+
+bool ApplianceBase::m_readFrame() {
+#if MIDEA_HAS_THREADS
+  // Bytes left in the ring after stopping are parsed before switching back to the stream
+  if (this->isRxThreadRunning() || this->m_rxRing.size())
+    return this->m_receiver.read(this->m_rxRing);
+#endif
+  return this->m_receiver.read(this->m_stream);
+}
+
+ApplianceBase::~ApplianceBase() {
+#if MIDEA_HAS_THREADS
+  this->stopRxThread();
+#endif
+}
+
+#if MIDEA_HAS_THREADS
+void ApplianceBase::startRxThread(RxWaiter waiter, uint32_t pollInterval) {
+  if (this->isRxThreadRunning())
+    return;
+  LOG_D(TAG, "Starting RX thread...");
+  this->m_rxWaiter = std::move(waiter);
+  this->m_rxPollInterval = pollInterval ? pollInterval : 1;
+  this->m_rxRunning.store(true);
+  this->m_rxThread = std::thread(&ApplianceBase::m_rxTask, this);
+}
+
+void ApplianceBase::stopRxThread() {
+  if (!this->isRxThreadRunning())
+    return;
+  LOG_D(TAG, "Stopping RX thread...");
+  this->m_rxRunning.store(false);
+  if (this->m_rxThread.joinable())
+    this->m_rxThread.join();
+}
+
+#ifndef ARDUINO
+ApplianceBase::RxWaiter ApplianceBase::fdWaiter(int fd) {
+  return [fd](uint32_t timeout) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    timeval tv{static_cast<time_t>(timeout / 1000), static_cast<suseconds_t>(timeout % 1000 * 1000)};
+    select(fd + 1, &fds, nullptr, nullptr, &tv);
+  };
+}
+#endif
+
+// Longest wait of RX waiter. Limits RX thread stop latency.
+static const uint32_t RX_WAIT_TIMEOUT = 100;
+
+void ApplianceBase::m_rxTask() {
+  while (this->m_rxRunning.load(std::memory_order_relaxed)) {
+    if (!this->m_stream->available()) {
+      if (this->m_rxWaiter != nullptr)
+        this->m_rxWaiter(RX_WAIT_TIMEOUT);
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(this->m_rxPollInterval));
       continue;
     }
-    this->m_data.push_back(data);
-    if (length > OFFSET_DATA && length >= this->m_data[OFFSET_LENGTH]) {
-      if (this->isValid())
-        return true;
-      this->m_data.clear();
-    }
+    do {
+      this->m_rxRing.push(this->m_stream->read());
+    } while (this->m_stream->available());
   }
-  return false;
 }
+#endif
 
 void ApplianceBase::setup() {
+  this->m_timerManager.update();
+  this->m_setupTime = this->m_timerManager.ms();
   this->m_timerManager.registerTimer(this->m_periodTimer);
   this->m_timerManager.registerTimer(this->m_networkTimer);
   this->m_timerManager.registerTimer(this->m_responseTimer);
+  this->m_timerManager.registerTimer(this->m_txTimer);
+  this->m_txTimer.setCallback([this](Timer *timer) {
+    timer->stop();
+    this->m_abortTx();
+  });
   this->m_networkTimer.setCallback([this](Timer *timer) {
     this->m_sendNetworkNotify();
     timer->reset();
   });
   this->m_networkTimer.start(2 * 60 * 1000);
-  this->m_networkTimer.call();
   this->m_setup();
+  this->m_runStartupPlan();
+}
+
+bool ApplianceBase::setStartupPlan(std::initializer_list<StartupStep> plan) {
+  uint8_t steps = 0;
+  for (auto step : plan) {
+    if (step > STARTUP_NETWORK || (steps & (1 << step))) {
+      LOG_W(TAG, "Startup plan with unknown or repeated steps is rejected.");
+      return false;
+    }
+    steps |= 1 << step;
+  }
+  this->m_startupPlanSize = 0;
+  for (auto step : plan)
+    this->m_startupPlan[this->m_startupPlanSize++] = step;
+  return true;
+}
+
+void ApplianceBase::m_runStartupStep(StartupStep step) {
+  switch (step) {
+    case STARTUP_STATUS:
+      if (this->m_queueStatus())
+        this->m_startupPending |= 1 << STARTUP_STATUS;
+      break;
+    case STARTUP_AUTOCONF:
+      if (this->m_queueAutoconf())
+        this->m_startupPending |= 1 << STARTUP_AUTOCONF;
+      break;
+    case STARTUP_NETWORK:
+      this->m_sendNetworkNotify();
+      break;
+  }
+}
+
+void ApplianceBase::m_runStartupPlan() {
+  bool autoconf = false;
+  for (uint8_t n = 0; n < this->m_startupPlanSize; ++n) {
+    autoconf |= this->m_startupPlan[n] == STARTUP_AUTOCONF;
+    this->m_runStartupStep(this->m_startupPlan[n]);
+  }
+  // Enabled autoconf completes only by its requests
+  if (!autoconf)
+    this->m_runStartupStep(STARTUP_AUTOCONF);
+}
+
+void ApplianceBase::m_addPoll(PollGenerator generator, uint8_t weight, uint32_t interval) {
+  this->m_pollPlan.push_back({std::move(generator), interval, this->m_timerManager.ms(), 0, weight, false});
+}
+
+void ApplianceBase::m_servePollPlan() {
+  const TimerTick now = this->m_timerManager.ms();
+  // Smooth weighted round-robin over eligible generators
+  int32_t total = 0;
+  for (auto &entry : this->m_pollPlan) {
+    entry.skip = !entry.weight || (entry.interval && now - entry.last < entry.interval);
+    if (entry.skip)
+      continue;
+    entry.current += entry.weight;
+    total += entry.weight;
+  }
+  for (;;) {
+    PollEntry *best = nullptr;
+    for (auto &entry : this->m_pollPlan)
+      if (!entry.skip && (best == nullptr || entry.current > best->current))
+        best = &entry;
+    if (best == nullptr)
+      return;
+    if (best->generator()) {
+      best->current -= total;
+      best->last = now;
+      return;
+    }
+    // Declined generator stays due and doesn't take part in this slot
+    best->current -= best->weight;
+    total -= best->weight;
+    best->skip = true;
+  }
+}
+
+void ApplianceBase::m_onStartupStep(StartupStep step) {
+  this->m_startupPending &= ~(1 << step);
+  Optional<uint32_t> &metric = (step == STARTUP_STATUS) ? this->m_timeToFirstStatus : this->m_timeToAutoconf;
+  if (metric.hasValue())
+    return;
+  metric = this->m_timerManager.ms() - this->m_setupTime;
+  LOG_I(TAG, "Startup: %s in %u ms.", (step == STARTUP_STATUS) ? "first status" : "autoconf complete",
+        static_cast<unsigned>(metric.value()));
 }
 
 void ApplianceBase::loop() {
   // Timers task
-  m_timerManager.task();
+  {
+    MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_TIMERS);
+    MIDEA_ALLOC_SCOPE(ALLOC_TIMERS);
+    m_timerManager.task();
+  }
   // Loop for appliances
-  m_loop();
+  {
+    MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_APPLIANCE);
+    MIDEA_ALLOC_SCOPE(ALLOC_APPLIANCE);
+    m_loop();
+  }
   // Frame receiving
-  while (this->m_receiver.read(this->m_stream)) {
+  for (;;) {
+    {
+      MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_RX);
+      MIDEA_ALLOC_SCOPE(ALLOC_RX);
+      if (!this->m_readFrame())
+        break;
+    }
+    MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_HANDLER);
+    MIDEA_ALLOC_SCOPE(ALLOC_HANDLER);
+    this->m_metrics.framesRx.inc();
     this->m_protocol = this->m_receiver.getProtocol();
     LOG_D(TAG, "RX: %s", this->m_receiver.toString().c_str());
     this->m_handler(this->m_receiver);
     this->m_receiver.clear();
   }
+#if MIDEA_HAS_COROUTINES
+  {
+    MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_HANDLER);
+    MIDEA_ALLOC_SCOPE(ALLOC_HANDLER);
+    this->m_resumeAwaiters();
+  }
+#endif
+  // Resume pending transmission
+  {
+    MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_TX);
+    MIDEA_ALLOC_SCOPE(ALLOC_TX);
+    if (this->m_isTransmitting() && !this->m_writeTx())
+      return;
+  }
   if (this->m_isBusy || this->m_isWaitForResponse())
     return;
   if (this->m_queue.empty()) {
+    MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_IDLE);
+    MIDEA_ALLOC_SCOPE(ALLOC_IDLE);
     this->m_onIdle();
     return;
   }
   this->m_request = this->m_queue.front();
   this->m_queue.pop_front();
+  this->m_metrics.queueDepth.set(this->m_queue.size());
   LOG_D(TAG, "Getting and sending a request from the queue...");
+  this->m_resetAttempts();
+  // Response timeout starts when last byte is sent
+  MIDEA_PROFILE_SCOPE(this->m_profiler, PHASE_TX);
+  MIDEA_ALLOC_SCOPE(ALLOC_TX);
   this->m_sendRequest(this->m_request);
-  if (this->m_request->onData != nullptr) {
-    this->m_resetAttempts();
-    this->m_resetTimeout();
-  } else {
-    this->m_destroyRequest();
-  }
 }
 
 void ApplianceBase::m_handler(const Frame &frame) {
   if (this->m_isWaitForResponse()) {
     auto result = this->m_request->callHandler(frame);
+    if (result == RESPONSE_WRONG)
+      this->m_metrics.wrongResponses.inc();
+    else if (this->m_responseTimer.isEnabled())
+      this->m_recordLatency(this->m_request->requestType, this->m_responseTimer.elapsed());
     if (result != RESPONSE_WRONG) {
       if (result == RESPONSE_OK) {
         if (this->m_request->onSuccess != nullptr)
           this->m_request->onSuccess();
         this->m_destroyRequest();
+        // Pipeline startup transactions: appliance is ready right after response
+        if (this->m_isStartup() && this->m_periodTimer.isEnabled() &&
+            this->m_periodTimer.elapsed() + this->m_startupGap < this->m_periodTimer.getAlarm())
+          this->m_periodTimer.start(this->m_startupGap);
       } else {
         this->m_resetAttempts();
         this->m_resetTimeout();
@@ -136,7 +359,7 @@ static bool isWifiConnected() {
 static IPAddress getLocalIP() {
   return WiFi.localIP();
 }
-#else
+#elif defined(ESP_PLATFORM)
 // ESP-IDF implementations
 static uint8_t getSignalStrength() {
   wifi_ap_record_t ap_info;
@@ -167,35 +390,80 @@ static IPAddress getLocalIP() {
   }
   return IPAddress();
 }
+#else
+// Host build: network is always up
+static uint8_t getSignalStrength() { return 4; }
+
+static bool isWifiConnected() { return true; }
+
+static IPAddress getLocalIP() { return IPAddress(127, 0, 0, 1); }
 #endif
 
 void ApplianceBase::m_sendNetworkNotify(FrameType msgType) {
-  NetworkNotifyData notify{};
-  notify.setConnected(isWifiConnected());
-  notify.setSignalStrength(getSignalStrength());
-  notify.setIP(getLocalIP());
-  notify.appendCRC();
+  const bool connected = isWifiConnected();
+  const uint8_t signal = getSignalStrength();
+  const IPAddress ip = getLocalIP();
+  const uint64_t key = (static_cast<uint64_t>(ip[0]) << 40) | (static_cast<uint64_t>(ip[1]) << 32) |
+                       (static_cast<uint32_t>(ip[2]) << 24) | (static_cast<uint32_t>(ip[3]) << 16) |
+                       (signal << 8) | connected;
+  // Frame is rebuilt only on network state change. If both buffers are still in use, old frame is sent.
+  TxFrame *frame = &this->m_notifyFrames[this->m_notifyIdx];
+  if (frame->empty() || key != this->m_notifyKey) {
+    if (!frame->empty() && this->m_isFrameUsed(frame))
+      frame = &this->m_notifyFrames[this->m_notifyIdx ^ 1];
+    if (!this->m_isFrameUsed(frame)) {
+      NetworkNotifyData notify{};
+      notify.setConnected(connected);
+      notify.setSignalStrength(signal);
+      notify.setIP(ip);
+      notify.appendCRC();
+      *frame = TxFrame(this->m_appType, msgType, notify);
+      this->m_notifyIdx = frame - this->m_notifyFrames;
+      this->m_notifyKey = key;
+    } else {
+      frame = &this->m_notifyFrames[this->m_notifyIdx];
+    }
+  }
   if (msgType == NETWORK_NOTIFY) {
     LOG_D(TAG, "Enqueuing a DEVICE_NETWORK(0x0D) notification...");
-    this->m_queueNotify(msgType, std::move(notify));
+    this->m_queueRequest(msgType, frame, nullptr);
   } else {
     LOG_D(TAG, "Answer to QUERY_NETWORK(0x63) request...");
-    this->m_sendFrame(msgType, std::move(notify));
+    this->m_sendFrame(msgType, *frame);
   }
 }
 
+bool ApplianceBase::m_isFrameUsed(const TxFrame *frame) const {
+  if (this->m_isTransmitting() && this->m_tx.frame == frame)
+    return true;
+  if (this->m_request != nullptr && this->m_request->cached == frame)
+    return true;
+  for (const Request *request : this->m_queue)
+    if (request->cached == frame)
+      return true;
+  return false;
+}
+
 void ApplianceBase::m_resetTimeout() {
   this->m_responseTimer.setCallback([this](Timer *timer) {
     LOG_D(TAG, "Response timeout...");
+    this->m_metrics.timeouts.inc();
     if (!--this->m_remainAttempts) {
+      this->m_metrics.failures.inc();
       if (this->m_request->onError != nullptr)
         this->m_request->onError();
       this->m_destroyRequest();
       return;
     }
     LOG_D(TAG, "Sending request again. Attempts left: %d...", this->m_remainAttempts);
-    this->m_sendRequest(this->m_request);
-    this->m_resetTimeout();
+    timer->stop();
+    this->m_metrics.retries.inc();
+    // Frame started meanwhile (e.g. answer to QUERY_NETWORK) is completed first
+    if (this->m_isTransmitting()) {
+      this->m_retryPending = true;
+      return;
+    }
+    this->m_sendRequest(this->m_request, true);
   });
   this->m_responseTimer.start(this->m_timeout);
 }
@@ -203,14 +471,129 @@ void ApplianceBase::m_resetTimeout() {
 void ApplianceBase::m_destroyRequest() {
   LOG_D(TAG, "Destroying the request...");
   this->m_responseTimer.stop();
-  delete this->m_request;
+  this->m_retryPending = false;
+  if (this->m_tx.isRequest && this->m_isTransmitting()) {
+    if (!this->m_tx.offset) {
+      LOG_D(TAG, "Request is destroyed before it is sent. Transmission canceled.");
+      this->m_tx = TxState{};
+      this->m_txTimer.stop();
+    } else {
+      // Started frame is finished to keep link in sync. Request payload is released below, so it is copied.
+      if (this->m_tx.data != nullptr && this->m_tx.data != &this->m_txData) {
+        this->m_txData = *this->m_tx.data;
+        this->m_tx.data = &this->m_txData;
+      }
+      this->m_tx.isRequest = false;
+    }
+  }
+  this->m_releaseRequest(this->m_request);
   this->m_request = nullptr;
 }
 
 void ApplianceBase::m_sendFrame(FrameType type, const FrameData &data) {
-  Frame frame(this->m_appType, this->m_protocol, type, data);
-  LOG_D(TAG, "TX: %s", frame.toString().c_str());
-  this->m_stream->write(frame.data(), frame.size());
+  if (this->m_isTransmitting()) {
+    this->m_queueRequestPriority(type, data);
+    return;
+  }
+  this->m_startTx(nullptr, &data, type, false, false);
+}
+
+void ApplianceBase::m_sendFrame(FrameType type, TxFrame &frame) {
+  if (this->m_isTransmitting()) {
+    this->m_queueRequest(type, &frame, nullptr);
+    return;
+  }
+  frame.prepare(this->m_protocol, type);
+  this->m_startTx(&frame, nullptr, type, true, false);
+}
+
+void ApplianceBase::m_sendRequest(Request *request, bool retry) {
+  if (request->cached == nullptr) {
+    this->m_startTx(nullptr, &request->request, request->requestType, true, true);
+    return;
+  }
+  if (!retry)
+    request->cached->prepare(this->m_protocol, request->requestType);
+  this->m_startTx(request->cached, nullptr, request->requestType, true, true);
+}
+
+void ApplianceBase::m_startTx(const Frame *frame, const FrameData *data, FrameType type, bool persistent, bool isRequest) {
+  const size_t size = (frame != nullptr) ? frame->size() : Frame::OFFSET_DATA + data->size() + 1;
+  this->m_tx = TxState{frame, data, 0, size, type, this->m_protocol, isRequest};
+  if (frame != nullptr)
+    LOG_D(TAG, "TX: %s", frame->toString().c_str());
+  else
+    LOG_D(TAG, "TX: %s", FrameEncoder(this->m_appType, this->m_protocol, type, *data).toString().c_str());
+  if (this->m_writeTx())
+    return;
+  this->m_txTimer.start(this->m_timeout);
+  if (persistent)
+    return;
+  this->m_txData = *data;
+  this->m_tx.data = &this->m_txData;
+}
+
+void ApplianceBase::m_abortTx() {
+  LOG_W(TAG, "Stream doesn't accept data. Transmission aborted.");
+  this->m_metrics.txStalls.inc();
+  const bool isRequest = this->m_tx.isRequest;
+  this->m_tx = TxState{};
+  if (this->m_retryPending) {
+    this->m_retryPending = false;
+    this->m_sendRequest(this->m_request, true);
+    return;
+  }
+  // Aborted request is handled as sent without response: retried or failed after timeout
+  if (isRequest && this->m_request != nullptr)
+    this->m_resetTimeout();
+}
+
+bool ApplianceBase::m_writeTx() {
+  size_t num = this->m_tx.size - this->m_tx.offset;
+  const int space = this->m_stream->availableForWrite();
+  if (space > 0) {
+    this->m_txReportsSpace = true;
+    num = std::min(num, static_cast<size_t>(space));
+  } else if (this->m_txReportsSpace) {
+    return false;
+  }
+  if (this->m_tx.frame != nullptr)
+    this->m_tx.offset += this->m_stream->write(this->m_tx.frame->data() + this->m_tx.offset, num);
+  else
+    this->m_tx.offset += FrameEncoder(this->m_appType, this->m_tx.protocol, this->m_tx.type, *this->m_tx.data)
+                             .write(this->m_stream, this->m_tx.offset, num);
+  if (this->m_isTransmitting())
+    return false;
+  this->m_onTxComplete();
+  return true;
+}
+
+void ApplianceBase::m_onTxComplete() {
+  const bool isRequest = this->m_tx.isRequest;
+  this->m_tx = TxState{};
+  this->m_txTimer.stop();
+  this->m_metrics.framesTx.inc();
+  this->m_startPeriod();
+  if (this->m_retryPending) {
+    this->m_retryPending = false;
+    this->m_sendRequest(this->m_request, true);
+    return;
+  }
+  if (!isRequest || this->m_request == nullptr)
+    return;
+  if (this->m_request->onData == nullptr)
+    this->m_destroyRequest();
+  else
+    this->m_resetTimeout();
+}
+
+void ApplianceBase::m_recordLatency(FrameType type, uint32_t ms) {
+  const size_t idx = ProtocolMetrics::typeIndex(type);
+  if (idx < ProtocolMetrics::LATENCY_TYPES)
+    this->m_metrics.latency[idx].add(ms);
+}
+
+void ApplianceBase::m_startPeriod() {
   this->m_isBusy = true;
   this->m_periodTimer.setCallback([this](Timer *timer) {
     this->m_isBusy = false;
@@ -220,15 +603,155 @@ void ApplianceBase::m_sendFrame(FrameType type, const FrameData &data) {
 }
 
 void ApplianceBase::m_queueRequest(FrameType type, FrameData data, ResponseHandler onData, Handler onSuccess, Handler onError) {
+  MIDEA_ALLOC_SCOPE(ALLOC_QUEUE);
   LOG_D(TAG, "Enqueuing the request...");
-  this->m_queue.push_back(new Request{std::move(data), std::move(onData), std::move(onSuccess), std::move(onError), type});
+  this->m_enqueue(new Request{std::move(data), nullptr, std::move(onData), std::move(onSuccess), std::move(onError), type}, false);
+}
+
+void ApplianceBase::m_queueRequest(FrameType type, TxFrame *frame, ResponseHandler onData, Handler onSuccess, Handler onError) {
+  MIDEA_ALLOC_SCOPE(ALLOC_QUEUE);
+  LOG_D(TAG, "Enqueuing the request...");
+  this->m_enqueue(new Request{FrameData(static_cast<uint8_t>(0)), frame, std::move(onData), std::move(onSuccess), std::move(onError), type}, false);
 }
 
 void ApplianceBase::m_queueRequestPriority(FrameType type, FrameData data, ResponseHandler onData, Handler onSuccess, Handler onError) {
+  MIDEA_ALLOC_SCOPE(ALLOC_QUEUE);
   LOG_D(TAG, "Priority request queuing...");
-  this->m_queue.push_front(new Request{std::move(data), std::move(onData), std::move(onSuccess), std::move(onError), type});
+  this->m_enqueue(new Request{std::move(data), nullptr, std::move(onData), std::move(onSuccess), std::move(onError), type}, true);
+}
+
+// FNV-1a
+static uint32_t hashBytes(uint32_t hash, const uint8_t *data, size_t size) {
+  for (; size; --size, ++data)
+    hash = (hash ^ *data) * 16777619U;
+  return hash;
 }
 
+uint32_t ApplianceBase::m_requestClass(const Request *request) {
+  const uint8_t *data = request->request.data();
+  size_t size = request->request.size();
+  if (request->cached != nullptr) {
+    data = request->cached->data() + Frame::OFFSET_DATA;
+    size = request->cached->size() - Frame::OFFSET_DATA - 1;
+  }
+  // Without trailing CRC
+  if (size)
+    --size;
+  const uint8_t type = request->requestType;
+  uint32_t hash = hashBytes(2166136261U, &type, 1);
+  if (!size || type == NETWORK_NOTIFY || type == QUERY_NETWORK)
+    return hash;
+  switch (data[0]) {
+    case 0x40:
+    case 0x48:
+      // Each control sets whole status and may be a step of sequence
+      return 0;
+    case 0xB0:
+      // ID(2), size(1), value(size)
+      hash = hashBytes(hash, data, 1);
+      for (size_t n = 2; n + 3 <= size; n += 3 + data[n + 2])
+        hash = hashBytes(hash, data + n, 2);
+      return hash;
+    case 0xB1:
+      // ID(2)
+      return hashBytes(hash, data, size);
+    default:
+      // ID and sub-command: 0x41 status, power and display queries, 0xB5 capabilities pages
+      return hashBytes(hash, data, std::min<size_t>(size, 3));
+  }
+}
+
+void ApplianceBase::m_dropRequest(Request *request) {
+  if (request->onError != nullptr)
+    request->onError();
+  this->m_releaseRequest(request);
+}
+
+void ApplianceBase::m_releaseRequest(Request *request) {
+#if MIDEA_HAS_COROUTINES
+  // Coroutines are resumed later from `loop()`, when request is not referenced anymore
+  if (request->awaiter != nullptr) {
+    if (this->m_awaitersTail != nullptr)
+      this->m_awaitersTail->m_next = request->awaiter;
+    else
+      this->m_awaitersHead = request->awaiter;
+    this->m_awaitersTail = request->awaiter;
+    return;
+  }
+#endif
+  delete request;
+}
+
+void ApplianceBase::m_enqueue(Request *request, bool priority) {
+  request->seq = this->m_enqueueSeq++;
+  if (this->m_queueLimit && this->m_queue.size() >= this->m_queueLimit) {
+    const uint32_t cls = m_requestClass(request);
+    auto it = this->m_queue.end();
+    if (cls && this->m_queuePolicy != QUEUE_REJECT_NEWEST) {
+      for (auto i = this->m_queue.begin(); i != this->m_queue.end(); ++i)
+        if ((it == this->m_queue.end() || static_cast<int32_t>((*i)->seq - (*it)->seq) < 0) &&
+            m_requestClass(*i) == cls)
+          it = i;
+    }
+    if (it == this->m_queue.end() || this->m_queuePolicy == QUEUE_REJECT_NEWEST) {
+      LOG_W(TAG, "Request queue is full. New request is rejected.");
+      ++this->m_queueStats.rejected;
+      this->m_dropRequest(request);
+      return;
+    }
+    Request *old = *it;
+    if (this->m_queuePolicy == QUEUE_REPLACE) {
+      LOG_D(TAG, "Request queue is full. Queued request is replaced.");
+      ++this->m_queueStats.replaced;
+      *it = request;
+      this->m_dropRequest(old);
+      return;
+    }
+    LOG_D(TAG, "Request queue is full. Oldest request of same class is dropped.");
+    ++this->m_queueStats.dropped;
+    this->m_queue.erase(it);
+    this->m_dropRequest(old);
+  }
+  if (priority)
+    this->m_queue.push_front(request);
+  else
+    this->m_queue.push_back(request);
+  this->m_metrics.queueDepth.set(this->m_queue.size());
+  if (this->m_queue.size() > this->m_queueStats.highWater)
+    this->m_queueStats.highWater = this->m_queue.size();
+}
+
+#if MIDEA_HAS_COROUTINES
+ApplianceBase::QueryAwaiter::QueryAwaiter(ApplianceBase *app, FrameType type, FrameData data, TxFrame *cached,
+                                          uint8_t responseID, bool priority)
+    : m_app(app), m_request{std::move(data), cached, nullptr, nullptr, nullptr, type, this},
+      m_responseID(responseID), m_priority(priority) {
+  // Captures only `this`, so handler is stored without allocation
+  this->m_request.onData = [this](FrameData data) -> ResponseStatus {
+    if (this->m_responseID && !data.hasID(this->m_responseID))
+      return ResponseStatus::RESPONSE_WRONG;
+    this->m_response = std::move(data);
+    return ResponseStatus::RESPONSE_OK;
+  };
+}
+
+void ApplianceBase::QueryAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  this->m_handle = handle;
+  this->m_app->m_enqueue(&this->m_request, this->m_priority);
+}
+
+void ApplianceBase::m_resumeAwaiters() {
+  while (this->m_awaitersHead != nullptr) {
+    QueryAwaiter *awaiter = this->m_awaitersHead;
+    this->m_awaitersHead = awaiter->m_next;
+    if (this->m_awaitersHead == nullptr)
+      this->m_awaitersTail = nullptr;
+    // Awaiter is destroyed by coroutine after resuming
+    awaiter->m_handle.resume();
+  }
+}
+#endif
+
 void ApplianceBase::setBeeper(bool value) {
   LOG_D(TAG, "Turning %s beeper feedback...", value ? "ON" : "OFF");
   this->m_beeper = value;
@@ -0,0 +1,116 @@
+#include "Appliance/Dehumidifier/Dehumidifier.h"
+#include "Helpers/Log.h"
+#include <algorithm>
+
+namespace dudanov {
+namespace midea {
+namespace dh {
+
+static const char *TAG = "Dehumidifier";
+
+void Dehumidifier::m_setup() {
+  this->m_addPoll([this]() {
+    this->m_getStatus();
+    return true;
+  }, 1);
+}
+
+void Dehumidifier::control(const Control &control) {
+  if (this->m_sendControl)
+    return;
+  State state = this->m_state;
+  bool hasUpdate = false;
+  if (control.power.hasUpdate(state.power)) {
+    hasUpdate = true;
+    state.power = control.power.value();
+  }
+  if (control.mode.hasUpdate(state.mode)) {
+    hasUpdate = true;
+    state.mode = control.mode.value();
+  }
+  if (control.fanSpeed.hasUpdate(state.fanSpeed)) {
+    hasUpdate = true;
+    state.fanSpeed = control.fanSpeed.value();
+  }
+  if (control.targetHumidity.hasUpdate(state.targetHumidity)) {
+    hasUpdate = true;
+    state.targetHumidity = std::min<uint8_t>(control.targetHumidity.value(), 100);
+  }
+  if (control.ion.hasUpdate(state.ion)) {
+    hasUpdate = true;
+    state.ion = control.ion.value();
+  }
+  if (!hasUpdate)
+    return;
+  StatusData status = this->m_status;
+  status.set<STATUS_POWER>(state.power);
+  status.set<STATUS_MODE>(state.mode);
+  status.set<STATUS_FAN_SPEED>(state.fanSpeed);
+  status.set<STATUS_TARGET_HUMIDITY>(state.targetHumidity);
+  status.set<STATUS_ION>(state.ion);
+  status.setBeeper(this->m_beeper);
+  status.appendCRC();
+  this->m_sendControl = true;
+  this->m_setStatus(std::move(status));
+}
+
+void Dehumidifier::m_setStatus(StatusData status) {
+  LOG_D(TAG, "Enqueuing a priority SET_STATUS(0x48) request...");
+  this->m_queueRequestPriority(FrameType::DEVICE_CONTROL, std::move(status),
+    // onData
+    std::bind(&Dehumidifier::m_readStatus, this, std::placeholders::_1),
+    // onSuccess
+    [this]() {
+      this->m_sendControl = false;
+    },
+    // onError
+    [this]() {
+      LOG_W(TAG, "SET_STATUS(0x48) request failed...");
+      this->m_sendControl = false;
+    }
+  );
+}
+
+void Dehumidifier::m_getStatus() {
+  LOG_D(TAG, "Enqueuing a GET_STATUS(0x41) request...");
+  this->m_queueRequest(FrameType::DEVICE_QUERY, &this->m_statusQuery,
+    // onData
+    std::bind(&Dehumidifier::m_readStatus, this, std::placeholders::_1)
+  );
+}
+
+template<typename T>
+static void setProperty(T &property, const T &value, StateMask &changed, StateMask field) {
+  if (property != value) {
+    property = value;
+    changed |= field;
+  }
+}
+
+ResponseStatus Dehumidifier::m_readStatus(FrameData data) {
+  if (!data.hasID(0xC8))
+    return ResponseStatus::RESPONSE_WRONG;
+  this->m_onStartupStep(STARTUP_STATUS);
+  const StatusData statusData = data.to<StatusData>();
+  this->m_status.copyStatus(statusData);
+  const StatusMap::Values status = statusData.decode();
+  StateMask changed = 0;
+  setProperty(this->m_state.power, status[STATUS_POWER] != 0, changed, FIELD_POWER);
+  setProperty(this->m_state.mode, static_cast<Mode>(status[STATUS_MODE]), changed, FIELD_MODE);
+  setProperty(this->m_state.fanSpeed, static_cast<FanSpeed>(status[STATUS_FAN_SPEED]), changed, FIELD_FAN_SPEED);
+  setProperty(this->m_state.targetHumidity, static_cast<uint8_t>(std::min<int16_t>(status[STATUS_TARGET_HUMIDITY], 100)),
+              changed, FIELD_TARGET_HUMIDITY);
+  setProperty(this->m_state.ion, status[STATUS_ION] != 0, changed, FIELD_ION);
+  setProperty(this->m_state.tankLevel, static_cast<uint8_t>(status[STATUS_TANK_LEVEL]), changed, FIELD_TANK_LEVEL);
+  setProperty(this->m_state.indoorHumidity, static_cast<uint8_t>(status[STATUS_INDOOR_HUMIDITY]), changed,
+              FIELD_INDOOR_HUMIDITY);
+  setProperty(this->m_state.indoorTemp, static_cast<Temp10>(status[STATUS_INDOOR_TEMP]), changed, FIELD_INDOOR_TEMP);
+  setProperty(this->m_state.errorCode, static_cast<uint8_t>(status[STATUS_ERROR_CODE]), changed, FIELD_ERROR_CODE);
+  if (changed)
+    this->sendUpdate(changed);
+  return ResponseStatus::RESPONSE_OK;
+}
+
+}  // namespace dh
+}  // namespace midea
+}  // namespace dudanov
@@ -1,8 +1,21 @@
 #include "Frame/Frame.h"
+#include <algorithm>
 
 namespace dudanov {
 namespace midea {
 
+#if __cplusplus < 201703L
+// Out-of-class definitions for ODR-uses such as `std::find()`. Implicitly inline since C++17.
+constexpr uint8_t Frame::START_BYTE;
+constexpr uint8_t Frame::OFFSET_START;
+constexpr uint8_t Frame::OFFSET_LENGTH;
+constexpr uint8_t Frame::OFFSET_APPTYPE;
+constexpr uint8_t Frame::OFFSET_SYNC;
+constexpr uint8_t Frame::OFFSET_PROTOCOL;
+constexpr uint8_t Frame::OFFSET_TYPE;
+constexpr uint8_t Frame::OFFSET_DATA;
+#endif
+
 void Frame::setData(const FrameData &data) {
   this->m_trimData();
   this->m_appendData(data);
@@ -20,19 +33,81 @@ uint8_t Frame::m_calcCS() const {
   return cs;
 }
 
+void TxFrame::prepare(uint8_t protocol, uint8_t type) {
+  this->m_patch(OFFSET_PROTOCOL, protocol);
+  this->m_patch(OFFSET_TYPE, type);
+  if (!this->m_seqIndex)
+    return;
+  const uint8_t idx = OFFSET_DATA + this->m_seqIndex;
+  const uint8_t idxCRC = this->size() - 2;
+  const uint8_t value = FrameData::m_getID();
+  // CRC8 is linear: CRC of changed payload is old CRC xor CRC of difference
+  const uint8_t diff = this->m_data[idx] ^ value;
+  const uint8_t zero = 0;
+  uint8_t crc = FrameData::calcCRC(&diff, 1);
+  for (uint8_t n = idx + 1; n < idxCRC; ++n)
+    crc = FrameData::calcCRC(&zero, 1, crc);
+  this->m_patch(idx, value);
+  this->m_patch(idxCRC, this->m_data[idxCRC] ^ crc);
+}
+
+FrameEncoder::FrameEncoder(uint8_t appliance, uint8_t protocol, uint8_t type, const FrameData &data)
+  : m_header{Frame::START_BYTE, 0x00, appliance, 0x00, 0x00, 0x00, 0x00, 0x00, protocol, type}, m_data(data) {
+  this->m_header[Frame::OFFSET_LENGTH] = this->size() - 1;
+  this->m_header[Frame::OFFSET_SYNC] = this->m_header[Frame::OFFSET_LENGTH] ^ appliance;
+  uint8_t cs = 0;
+  for (uint8_t n = Frame::OFFSET_LENGTH; n < Frame::OFFSET_DATA; ++n)
+    cs -= this->m_header[n];
+  for (uint8_t n = 0; n < data.size(); ++n)
+    cs -= data.data()[n];
+  this->m_cs = cs;
+}
+
+size_t FrameEncoder::write(Stream *stream, size_t offset, size_t num) const {
+  const uint8_t *const parts[] = {this->m_header, this->m_data.data(), &this->m_cs};
+  const size_t sizes[] = {Frame::OFFSET_DATA, this->m_data.size(), 1};
+  size_t written = 0;
+  for (size_t n = 0, base = 0; n < 3 && num; base += sizes[n++]) {
+    if (offset >= base + sizes[n])
+      continue;
+    const size_t pos = offset - base;
+    const size_t len = std::min(sizes[n] - pos, num);
+    const size_t accepted = stream->write(parts[n] + pos, len);
+    written += accepted;
+    if (accepted < len)
+      break;
+    offset += len;
+    num -= len;
+  }
+  return written;
+}
+
 static char u4hex(uint8_t num) { return num + ((num < 10) ? '0' : ('A' - 10)); }
 
-String Frame::toString() const {
-  String ret;
+static void appendHex(String &ret, const uint8_t *data, size_t size) {
   char buf[4];
   buf[2] = ' ';
   buf[3] = '\0';
-  ret.reserve(3 * this->size());
-  for (const uint8_t data : this->m_data) {
-    buf[0] = u4hex(data / 16);
-    buf[1] = u4hex(data % 16);
+  for (; size; --size, ++data) {
+    buf[0] = u4hex(*data / 16);
+    buf[1] = u4hex(*data % 16);
     ret += buf;
   }
+}
+
+String Frame::toString() const {
+  String ret;
+  ret.reserve(3 * this->size());
+  appendHex(ret, this->data(), this->size());
+  return ret;
+}
+
+String FrameEncoder::toString() const {
+  String ret;
+  ret.reserve(3 * this->size());
+  appendHex(ret, this->m_header, sizeof(this->m_header));
+  appendHex(ret, this->m_data.data(), this->m_data.size());
+  appendHex(ret, &this->m_cs, 1);
   return ret;
 }
 
@@ -0,0 +1,92 @@
+#include "Helpers/AllocTracker.h"
+
+#if MIDEA_ALLOC_TRACKING
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace dudanov {
+
+static thread_local const char *s_site = nullptr;
+// Guards against accounting allocations made by tracker itself
+static thread_local bool s_inTracker = false;
+static std::atomic<bool> s_enabled{false};
+static std::atomic<uint32_t> s_allocations{0};
+static std::atomic<uint32_t> s_frees{0};
+static std::atomic<uint64_t> s_bytes{0};
+static std::mutex s_mutex;
+static AllocSite s_sites[AllocTracker::MAX_SITES];
+static size_t s_numSites = 0;
+
+AllocTracker::Scope::Scope(const char *site) : m_prev(s_site) { s_site = site; }
+AllocTracker::Scope::~Scope() { s_site = this->m_prev; }
+
+void AllocTracker::setEnabled(bool state) { s_enabled.store(state); }
+bool AllocTracker::isEnabled() { return s_enabled.load(); }
+uint32_t AllocTracker::allocations() { return s_allocations.load(std::memory_order_relaxed); }
+uint32_t AllocTracker::frees() { return s_frees.load(std::memory_order_relaxed); }
+uint64_t AllocTracker::bytes() { return s_bytes.load(std::memory_order_relaxed); }
+
+size_t AllocTracker::getSites(AllocSite *sites, size_t size) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  size_t n = 0;
+  for (; n < s_numSites && n < size; ++n)
+    sites[n] = s_sites[n];
+  return n;
+}
+
+void AllocTracker::reset() {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_allocations.store(0);
+  s_frees.store(0);
+  s_bytes.store(0);
+  s_numSites = 0;
+}
+
+void AllocTracker::onAlloc(size_t size) {
+  if (!s_enabled.load(std::memory_order_relaxed) || s_inTracker)
+    return;
+  s_inTracker = true;
+  s_allocations.fetch_add(1, std::memory_order_relaxed);
+  s_bytes.fetch_add(size, std::memory_order_relaxed);
+  const char *site = (s_site != nullptr) ? s_site : UNATTRIBUTED;
+  {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    size_t n = 0;
+    while (n < s_numSites && s_sites[n].name != site)
+      ++n;
+    if (n == s_numSites && s_numSites < MAX_SITES)
+      s_sites[s_numSites++] = {site, 0, 0};
+    if (n < s_numSites) {
+      ++s_sites[n].count;
+      s_sites[n].bytes += size;
+    }
+  }
+  s_inTracker = false;
+}
+
+void AllocTracker::onFree() {
+  if (s_enabled.load(std::memory_order_relaxed))
+    s_frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace dudanov
+
+void *operator new(size_t size) {
+  dudanov::AllocTracker::onAlloc(size);
+  void *ptr = std::malloc(size ? size : 1);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr != nullptr)
+    dudanov::AllocTracker::onFree();
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+#endif
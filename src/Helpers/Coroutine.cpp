@@ -0,0 +1,39 @@
+#include "Helpers/Coroutine.h"
+
+#if MIDEA_HAS_COROUTINES
+
+namespace dudanov {
+
+static_assert(MIDEA_CORO_FRAMES <= 32, "Too many coroutine frames");
+
+CoroFramePool::Block CoroFramePool::s_blocks[MIDEA_CORO_FRAMES];
+uint32_t CoroFramePool::s_usedMask;
+
+void *CoroFramePool::allocate(size_t size) noexcept {
+  if (size > sizeof(Block))
+    return nullptr;
+  for (uint8_t n = 0; n < MIDEA_CORO_FRAMES; ++n) {
+    const uint32_t bit = 1UL << n;
+    if (s_usedMask & bit)
+      continue;
+    s_usedMask |= bit;
+    return s_blocks[n].data;
+  }
+  return nullptr;
+}
+
+void CoroFramePool::deallocate(void *ptr) noexcept {
+  const size_t n = static_cast<Block *>(ptr) - s_blocks;
+  s_usedMask &= ~(1UL << n);
+}
+
+uint8_t CoroFramePool::used() noexcept {
+  uint8_t num = 0;
+  for (uint32_t mask = s_usedMask; mask; mask &= mask - 1)
+    ++num;
+  return num;
+}
+
+}  // namespace dudanov
+
+#endif  // MIDEA_HAS_COROUTINES
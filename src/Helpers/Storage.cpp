@@ -0,0 +1,69 @@
+#include "Helpers/Storage.h"
+
+#ifndef ARDUINO
+#include <cstdio>
+#endif
+
+#ifdef ESP_PLATFORM
+#include "nvs.h"
+#endif
+
+namespace dudanov {
+
+uint8_t blobChecksum(const uint8_t *data, size_t size) {
+  uint8_t cs = 0;
+  while (size--)
+    cs -= *data++;
+  return cs;
+}
+
+#ifndef ARDUINO
+void FileStorage::m_path(char *buf, size_t size, const char *key) const {
+  snprintf(buf, size, "%s/%s.bin", this->m_dir, key);
+}
+
+size_t FileStorage::load(const char *key, uint8_t *data, size_t size) {
+  char path[128];
+  this->m_path(path, sizeof(path), key);
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr)
+    return 0;
+  const size_t len = fread(data, 1, size, file);
+  fclose(file);
+  return len;
+}
+
+bool FileStorage::save(const char *key, const uint8_t *data, size_t size) {
+  char path[128];
+  this->m_path(path, sizeof(path), key);
+  FILE *file = fopen(path, "wb");
+  if (file == nullptr)
+    return false;
+  const bool ok = fwrite(data, 1, size, file) == size;
+  return !fclose(file) && ok;
+}
+#endif
+
+#ifdef ESP_PLATFORM
+size_t NvsStorage::load(const char *key, uint8_t *data, size_t size) {
+  nvs_handle_t handle;
+  if (nvs_open(this->m_ns, NVS_READONLY, &handle) != ESP_OK)
+    return 0;
+  size_t len = size;
+  if (nvs_get_blob(handle, key, data, &len) != ESP_OK)
+    len = 0;
+  nvs_close(handle);
+  return len;
+}
+
+bool NvsStorage::save(const char *key, const uint8_t *data, size_t size) {
+  nvs_handle_t handle;
+  if (nvs_open(this->m_ns, NVS_READWRITE, &handle) != ESP_OK)
+    return false;
+  const bool ok = nvs_set_blob(handle, key, data, size) == ESP_OK && nvs_commit(handle) == ESP_OK;
+  nvs_close(handle);
+  return ok;
+}
+#endif
+
+}  // namespace dudanov
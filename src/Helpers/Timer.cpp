@@ -3,15 +3,38 @@
 
 namespace dudanov {
 
-TimerTick TimerManager::s_millis;
+TimerTick SystemClock::now() { return ::millis(); }
+
+SystemClock &SystemClock::instance() {
+  static SystemClock clock;
+  return clock;
+}
 
 // Dummy function for incorrect using case.
 static void dummy(Timer *timer) { timer->stop(); }
 Timer::Timer() : m_callback(dummy), m_alarm(0) {}
 
+void TimerManager::registerTimer(Timer &timer) {
+  timer.m_manager = this;
+  this->m_timers.push_back(&timer);
+}
+
+TimerTick TimerManager::untilNextDeadline() const {
+  TimerTick next = TIMER_NEVER;
+  for (auto timer : m_timers) {
+    if (!timer->isEnabled())
+      continue;
+    const TimerTick elapsed = timer->elapsed();
+    const TimerTick remain = (elapsed < timer->getAlarm()) ? timer->getAlarm() - elapsed : 0;
+    if (remain < next)
+      next = remain;
+  }
+  return next;
+}
+
 /// Timers task. Must be periodically called in loop function.
 void TimerManager::task() {
-  s_millis = ::millis();
+  this->update();
   for (auto timer : m_timers)
     if (timer->isEnabled() && timer->isExpired())
       timer->call();